@@ -0,0 +1,126 @@
+#include <QCoreApplication>
+#include <QSocketNotifier>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QVector>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <cstring>
+#include <memory>
+#include "../src/server/epolleventdispatcher.h"
+
+// Measures the overhead of dispatching events with many idle and active connections. Socket pairs stand in for the
+// websocket connections, so the numbers only depend on the event dispatcher.
+//
+// Usage: dispatchbenchmark [--epoll]
+
+// Amount of event loop iterations measured per configuration
+static const int Iterations = 200;
+
+// Share of the connections that receive a message each iteration when active
+static const int ActivePercentage = 10;
+
+struct Connection
+{
+	int fds[2];
+	std::unique_ptr<QSocketNotifier> notifier;
+};
+
+static bool createConnections(QVector<Connection> &connections, int count, int &received)
+{
+	connections.resize(count);
+	for(auto &connection : connections) {
+		if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, connection.fds) < 0) {
+			return false;
+		}
+
+		// Read the byte written to the other end, like a websocket reading a message
+		connection.notifier.reset(new QSocketNotifier(connection.fds[0], QSocketNotifier::Read));
+		int fd = connection.fds[0];
+		QObject::connect(connection.notifier.get(), &QSocketNotifier::activated, [fd, &received]() {
+			char byte;
+			while(read(fd, &byte, 1) == 1) {
+				received++;
+			}
+		});
+	}
+
+	return true;
+}
+
+static void closeConnections(QVector<Connection> &connections)
+{
+	for(auto &connection : connections) {
+		connection.notifier.reset();
+		close(connection.fds[0]);
+		close(connection.fds[1]);
+	}
+	connections.clear();
+}
+
+int main(int argc, char *argv[])
+{
+	bool epoll = false;
+	for(int i = 1; i < argc; i++) {
+		if(std::strcmp(argv[i], "--epoll") == 0) {
+			epoll = true;
+			QCoreApplication::setEventDispatcher(new EpollEventDispatcher());
+			break;
+		}
+	}
+
+	QCoreApplication app(argc, argv);
+	QTextStream out(stdout);
+
+	// Every connection needs two file descriptors
+	rlimit limit;
+	getrlimit(RLIMIT_NOFILE, &limit);
+	limit.rlim_cur = limit.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &limit);
+
+	out << "Dispatcher: " << (epoll ? "epoll" : "default") << "\n";
+	out << "connections\tidle (us/iteration)\tactive (us/iteration)\n";
+
+	for(int count : {1000, 10000, 50000}) {
+		int received = 0;
+		QVector<Connection> connections;
+		if(!createConnections(connections, count, received)) {
+			out << count << "\tfailed to create connections: " << strerror(errno) << " (raise the open files limit)\n";
+			out.flush();
+			closeConnections(connections);
+			continue;
+		}
+
+		// Idle: nothing to dispatch, this only measures the cost of checking all connections
+		QElapsedTimer timer;
+		timer.start();
+		for(int i = 0; i < Iterations; i++) {
+			app.processEvents(QEventLoop::AllEvents);
+		}
+		qint64 idle = timer.nsecsElapsed() / Iterations / 1000;
+
+		// Active: a share of the connections receives a message every iteration
+		int active = count * ActivePercentage / 100;
+		int expected = 0;
+		timer.restart();
+		for(int i = 0; i < Iterations; i++) {
+			for(int j = 0; j < active; j++) {
+				const Connection &connection = connections[(i * active + j) % count];
+				if(write(connection.fds[1], "x", 1) == 1) {
+					expected++;
+				}
+			}
+			while(received < expected) {
+				app.processEvents(QEventLoop::AllEvents);
+			}
+		}
+		qint64 busy = timer.nsecsElapsed() / Iterations / 1000;
+
+		out << count << "\t" << idle << "\t" << busy << "\n";
+		out.flush();
+		closeConnections(connections);
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -76,6 +76,15 @@ Q_SIGNALS:
      */
     void messageReceived(const Message &message);
 
+    /**
+     * @brief Indicate that the network interfaces in use have changed
+     *
+     * This signal is emitted when an interface is added or removed or when
+     * the addresses assigned to an interface change. Any previous answers may
+     * no longer be complete and continuous queries should start over.
+     */
+    void interfacesChanged();
+
     /**
      * @brief Indicate that an error has occurred
      * @param message brief description of the error
@@ -26,6 +26,7 @@
 #define QMDNSENGINE_BROWSER_H
 
 #include <QByteArray>
+#include <QList>
 #include <QObject>
 
 #include "qmdnsengine_export.h"
@@ -58,6 +59,13 @@ class QMDNSENGINE_EXPORT BrowserPrivate;
  * QMdnsEngine::Browser browser(&server, "_http._tcp.local.");
  * @endcode
  *
+ * To browse for services of several specific types, which is far cheaper
+ * than browsing for any type and filtering the results:
+ *
+ * @code
+ * QMdnsEngine::Browser browser(&server, {"_http._tcp.local.", "_ipp._tcp.local."});
+ * @endcode
+ *
  * When a service is found, the serviceAdded() signal is emitted:
  *
  * @code
@@ -84,6 +92,18 @@ public:
      */
     Browser(AbstractServer *server, const QByteArray &type, Cache *cache = 0, QObject *parent = 0);
 
+    /**
+     * @brief Create a new browser instance for several service types
+     * @param server server to use for receiving and sending mDNS messages
+     * @param types service types to browse for
+     * @param cache DNS cache to use or null to create one
+     * @param parent QObject
+     *
+     * All types share the cache and the subscriptions to received records.
+     * The services of a type are only tracked once the first one is found.
+     */
+    Browser(AbstractServer *server, const QList<QByteArray> &types, Cache *cache = 0, QObject *parent = 0);
+
 Q_SIGNALS:
 
     /**
@@ -25,11 +25,15 @@
 #ifndef QMDNSENGINE_CACHE_H
 #define QMDNSENGINE_CACHE_H
 
+#include <QHostAddress>
 #include <QList>
+#include <QMap>
 #include <QObject>
 
 #include "qmdnsengine_export.h"
 
+class QDataStream;
+
 namespace QMdnsEngine
 {
 
@@ -61,6 +65,16 @@ class QMDNSENGINE_EXPORT CachePrivate;
  * @endcode
  *
  * Alternatively, lookupRecord() can be used to find a single record.
+ *
+ * The memory used by the cache can be bounded with setMaximumEntries() and
+ * setMaximumSize(). When a limit is exceeded, records are evicted starting
+ * with the least recently used record of a type that is not watched (see
+ * addWatchedType()), followed by the least recently used record of any
+ * type. Evicted records are reported with recordExpired(), like records
+ * that reached the end of their lifetime, except for address records: they
+ * are still valid, so shouldQuery() is emitted to fetch them again instead.
+ * setMaximumEntriesPerSource() prevents a single host from filling the
+ * cache.
  */
 class QMDNSENGINE_EXPORT Cache : public QObject
 {
@@ -68,20 +82,86 @@ class QMDNSENGINE_EXPORT Cache : public QObject
 
 public:
 
+    /**
+     * @brief Statistics describing the current state of the cache
+     */
+    struct Stats
+    {
+        /// Number of records in the cache
+        int entries;
+        /// Approximate memory used by the records in bytes
+        qint64 size;
+        /// Number of records removed to stay within the limits
+        quint64 evictions;
+        /// Number of records refused because their source exceeded its quota
+        quint64 rejections;
+        /// Number of records for each type
+        QMap<quint16, int> entriesByType;
+        /// Number of lookups that retrieved at least one record
+        quint64 hits;
+        /// Number of lookups that did not retrieve any record
+        quint64 misses;
+        /// Number of records added
+        quint64 inserts;
+        /// Number of records replaced by a record with the cache-flush bit set
+        quint64 replacements;
+        /// Number of records that expired or were removed with a TTL of 0
+        quint64 expirations;
+        /// Number of scheduled shouldQuery() triggers
+        int pendingTriggers;
+    };
+
     /**
      * @brief Create an empty cache.
      */
     explicit Cache(QObject *parent = 0);
 
+    /**
+     * @brief Set the interval for the statsUpdated() signal
+     * @param msec interval in milliseconds or 0 to disable the signal
+     */
+    void setStatsInterval(int msec);
+
+    /**
+     * @brief Set the maximum number of records in the cache
+     * @param entries maximum number of records or a negative value for no limit
+     */
+    void setMaximumEntries(int entries);
+
+    /**
+     * @brief Set the maximum approximate memory used by the records
+     * @param size maximum size in bytes or a negative value for no limit
+     */
+    void setMaximumSize(qint64 size);
+
+    /**
+     * @brief Set the maximum number of records added from a single address
+     * @param entries maximum number of records or a negative value for no limit
+     *
+     * New records from an address that reached this limit are refused.
+     */
+    void setMaximumEntriesPerSource(int entries);
+
+    /**
+     * @brief Indicate that records for a service type are in use
+     * @param type service type, such as "_http._tcp.local."
+     *
+     * Records for types that are not watched are evicted first. Address
+     * records are always considered to be watched. When no type is watched,
+     * all records are.
+     */
+    void addWatchedType(const QByteArray &type);
+
     /**
      * @brief Add a record to the cache
      * @param record add this record to the cache
+     * @param source address of the host that sent the record or null if unknown
      *
      * The TTL for the record will be added to the current time to calculate
      * when the record expires. Existing records of the same name and type
      * will be replaced, resetting their expiration.
      */
-    void addRecord(const Record &record);
+    void addRecord(const Record &record, const QHostAddress &source = QHostAddress());
 
     /**
      * @brief Retrieve a single record from the cache
@@ -93,8 +173,10 @@ public:
      * Some record types allow multiple records to be stored with identical
      * names and types. This method will only retrieve the first matching
      * record. Use lookupRecords() to obtain all of the records.
+     *
+     * Like lookupRecords(), this marks the matching records as recently used.
      */
-    bool lookupRecord(const QByteArray &name, quint16 type, Record &record) const;
+    bool lookupRecord(const QByteArray &name, quint16 type, Record &record);
 
     /**
      * @brief Retrieve multiple records from the cache
@@ -102,8 +184,38 @@ public:
      * @param type type of records to retrieve or ANY for all types
      * @param records storage for the records retrieved
      * @return true if records were retrieved
+     *
+     * The retrieved records are marked as recently used, which delays their
+     * eviction, and the lookup is counted as a hit or miss in stats(). The
+     * method is not const for this reason.
+     */
+    bool lookupRecords(const QByteArray &name, quint16 type, QList<Record> &records);
+
+    /**
+     * @brief Write all records in the cache to a stream
+     * @param stream storage for the records
+     *
+     * Each record is written in DNS wire format together with the absolute
+     * time at which it expires, allowing it to be restored with
+     * loadRecords() after a restart.
+     */
+    void saveRecords(QDataStream &stream) const;
+
+    /**
+     * @brief Add the records previously written by saveRecords() to the cache
+     * @param stream stream to read the records from
+     * @return true if the stream could be read
+     *
+     * Records that have expired in the meantime are skipped. The TTL of the
+     * remaining records is set to their remaining lifetime so that they
+     * expire at the same time they would have without the restart.
+     */
+    bool loadRecords(QDataStream &stream);
+
+    /**
+     * @brief Retrieve statistics describing the current state of the cache
      */
-    bool lookupRecords(const QByteArray &name, quint16 type, QList<Record> &records) const;
+    Stats stats() const;
 
 Q_SIGNALS:
 
@@ -112,16 +224,28 @@ Q_SIGNALS:
      * @param record reference to the record that will soon expire
      *
      * This signal is emitted when a record reaches approximately 50%, 85%,
-     * 90%, and 95% of its lifetime.
+     * 90%, and 95% of its lifetime. It is also emitted when an address
+     * record is evicted to keep the cache within its limits.
      */
     void shouldQuery(const Record &record);
 
     /**
      * @brief Indicate that the specified record expired
      * @param record reference to the record that has expired
+     *
+     * This signal is also emitted when a record other than an address
+     * record is evicted to keep the cache within its limits.
      */
     void recordExpired(const Record &record);
 
+    /**
+     * @brief Provide a periodic snapshot of the statistics
+     * @param stats statistics at the time the signal is emitted
+     *
+     * This signal is emitted at the interval set with setStatsInterval().
+     */
+    void statsUpdated(const Stats &stats);
+
 private:
 
     CachePrivate *const d;
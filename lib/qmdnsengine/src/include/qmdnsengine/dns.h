@@ -26,6 +26,7 @@
 #define QMDNSENGINE_DNS_H
 
 #include <QByteArray>
+#include <QList>
 #include <QMap>
 
 #include "qmdnsengine_export.h"
@@ -111,6 +112,19 @@ QMDNSENGINE_EXPORT bool fromPacket(const QByteArray &packet, Message &message);
  */
 QMDNSENGINE_EXPORT void toPacket(const Message &message, QByteArray &packet);
 
+/**
+ * @brief Split a query with known answers into packets of a limited size
+ * @param message query with its known answers
+ * @param maximumSize maximum size of each packet in bytes
+ * @return messages to send right after each other
+ *
+ * The first message contains the queries and as many known answers as fit,
+ * the following ones the remaining known answers. All messages but the last
+ * have the TC bit set, so that responders wait for the rest of the known
+ * answers as described in RFC 6762 section 7.2.
+ */
+QMDNSENGINE_EXPORT QList<Message> splitKnownAnswers(const Message &message, int maximumSize);
+
 /**
  * @brief Retrieve the string representation of a DNS type
  * @param type integer type
@@ -53,6 +53,14 @@ QMDNSENGINE_EXPORT extern const QHostAddress MdnsIpv6Address;
  */
 QMDNSENGINE_EXPORT extern const QByteArray MdnsBrowseType;
 
+/**
+ * @brief Largest mDNS packet that fits in an Ethernet frame over IPv4 or IPv6
+ *
+ * RFC 6762 section 17 allows packets of up to 9000 bytes, but larger ones
+ * than the interface MTU are fragmented and often dropped.
+ */
+QMDNSENGINE_EXPORT extern const int MdnsMaximumPacketSize;
+
 }
 
 #endif // QMDNSENGINE_MDNS_H
@@ -78,6 +78,16 @@ Q_SIGNALS:
      */
     void resolved(const QHostAddress &address);
 
+    /**
+     * @brief Indicate that a previously resolved address is no longer valid
+     * @param address service address
+     *
+     * This signal is emitted when the record for the address expires from
+     * the cache, when it is removed with a TTL of 0 or when it is replaced by
+     * a record for another address with the cache-flush bit set.
+     */
+    void addressExpired(const QHostAddress &address);
+
 private:
 
     ResolverPrivate *const d;
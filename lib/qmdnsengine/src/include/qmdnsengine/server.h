@@ -53,11 +53,31 @@ class QMDNSENGINE_EXPORT Server : public AbstractServer
 
 public:
 
+    /**
+     * @brief Statistics describing the packets received by the server
+     */
+    struct Stats
+    {
+        /// Number of packets read from the sockets
+        quint64 packetsReceived;
+        /// Number of packets successfully decoded into a message
+        quint64 packetsParsed;
+        /// Number of packets that could not be decoded
+        quint64 packetsDropped;
+        /// Total size of the packets read from the sockets in bytes
+        quint64 bytesReceived;
+    };
+
     /**
      * @brief Create a new server
      */
     explicit Server(QObject *parent = 0);
 
+    /**
+     * @brief Retrieve statistics describing the packets received
+     */
+    Stats stats() const;
+
     /**
      * @brief Implementation of AbstractServer::sendMessage()
      */
@@ -0,0 +1,124 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef QMDNSENGINE_TRACE_H
+#define QMDNSENGINE_TRACE_H
+
+#include <QtGlobal>
+
+#include "qmdnsengine_export.h"
+
+class QIODevice;
+
+namespace QMdnsEngine
+{
+
+/**
+ * @brief Scoped span recorded in the trace buffer
+ *
+ * The span starts when the object is created and ends when it is destroyed.
+ * Spans are normally created with the QMDNSENGINE_TRACE_SPAN() macro, which
+ * expands to nothing unless the library was built with tracing enabled:
+ *
+ * @code
+ * void process()
+ * {
+ *     QMDNSENGINE_TRACE_SPAN("process", "example");
+ *     ...
+ * }
+ * @endcode
+ *
+ * Both the name and the category must be string literals, since only the
+ * pointers are stored.
+ */
+class QMDNSENGINE_EXPORT TraceSpan
+{
+public:
+
+    /**
+     * @brief Start a span
+     * @param name name of the span
+     * @param category comma-separated categories of the span
+     */
+    TraceSpan(const char *name, const char *category);
+
+    /**
+     * @brief End the span and record it
+     */
+    ~TraceSpan();
+
+private:
+
+    Q_DISABLE_COPY(TraceSpan)
+
+    const char *const mName;
+    const char *const mCategory;
+    const qint64 mStart;
+};
+
+/**
+ * @brief Retrieve the current time on the trace clock in nanoseconds
+ */
+QMDNSENGINE_EXPORT qint64 traceTimestamp();
+
+/**
+ * @brief Record a completed span in the trace buffer
+ * @param name name of the span (must be a string literal)
+ * @param category categories of the span (must be a string literal)
+ * @param start time the span started as returned by traceTimestamp()
+ * @param duration duration of the span in nanoseconds
+ *
+ * The buffer is a fixed-size ring that can be written to from any thread
+ * without locking. Once it is full, the oldest spans are overwritten.
+ */
+QMDNSENGINE_EXPORT void recordTraceSpan(const char *name, const char *category, qint64 start, qint64 duration);
+
+/**
+ * @brief Write the spans in the trace buffer as a Chrome trace
+ * @param device device to write the JSON document to
+ * @return true if the trace was written
+ *
+ * The output uses the Trace Event Format, which can be opened in Perfetto or
+ * chrome://tracing. Spans that are being overwritten while writing are
+ * skipped.
+ */
+QMDNSENGINE_EXPORT bool writeChromeTrace(QIODevice *device);
+
+/**
+ * @brief Remove all spans from the trace buffer
+ */
+QMDNSENGINE_EXPORT void clearTrace();
+
+}
+
+#ifdef QMDNSENGINE_TRACING
+#  define QMDNSENGINE_TRACE_CONCAT_(a, b) a##b
+#  define QMDNSENGINE_TRACE_CONCAT(a, b) QMDNSENGINE_TRACE_CONCAT_(a, b)
+#  define QMDNSENGINE_TRACE_SPAN(name, category) \
+    QMdnsEngine::TraceSpan QMDNSENGINE_TRACE_CONCAT(qmdnsengineTraceSpan, __LINE__)(name, category)
+#else
+#  define QMDNSENGINE_TRACE_SPAN(name, category)
+#endif
+
+#endif // QMDNSENGINE_TRACE_H
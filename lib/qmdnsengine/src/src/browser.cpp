@@ -30,43 +30,88 @@
 #include <qmdnsengine/message.h>
 #include <qmdnsengine/query.h>
 #include <qmdnsengine/record.h>
+#include <qmdnsengine/trace.h>
 
 #include "browser_p.h"
+#include "queryscheduler_p.h"
 
 using namespace QMdnsEngine;
 
-BrowserPrivate::BrowserPrivate(Browser *browser, AbstractServer *server, const QByteArray &type, Cache *existingCache)
+BrowserPrivate::BrowserPrivate(Browser *browser, AbstractServer *server, const QList<QByteArray> &types, Cache *existingCache)
     : QObject(browser),
       q(browser),
       server(server),
-      type(type),
+      dispatcher(Dispatcher::instance(server)),
+      any(types.contains(MdnsBrowseType)),
       cache(existingCache ? existingCache : new Cache(this))
 {
-    connect(server, &AbstractServer::messageReceived, this, &BrowserPrivate::onMessageReceived);
+    for (const QByteArray &type : types) {
+        this->types.insert(type);
+    }
+
+    // Only PTR records for the types and SRV and TXT records for their
+    // services are of interest, unless browsing for services of any type
+    if (any) {
+        dispatcher->subscribeAllRecords(this);
+        cache->addWatchedType(MdnsBrowseType);
+    } else {
+        for (const QByteArray &type : types) {
+            cache->addWatchedType(type);
+            dispatcher->subscribeRecords(this, type, PTR);
+            dispatcher->subscribeRecordSuffix(this, "." + type, SRV);
+            dispatcher->subscribeRecordSuffix(this, "." + type, TXT);
+        }
+    }
+
     connect(cache, &Cache::shouldQuery, this, &BrowserPrivate::onShouldQuery);
     connect(cache, &Cache::recordExpired, this, &BrowserPrivate::onRecordExpired);
-    connect(&queryTimer, &QTimer::timeout, this, &BrowserPrivate::onQueryTimeout);
     connect(&serviceTimer, &QTimer::timeout, this, &BrowserPrivate::onServiceTimeout);
 
-    queryTimer.setInterval(60 * 1000);
-    queryTimer.setSingleShot(true);
-
     serviceTimer.setInterval(100);
     serviceTimer.setSingleShot(true);
 
-    // Immediately begin browsing for services
-    onQueryTimeout();
+    // Immediately begin browsing for services, the scheduler takes care of
+    // repeating the queries with increasing intervals
+    if (any) {
+        QueryScheduler::instance(server)->addQuestion(this, MdnsBrowseType, PTR, cache);
+    } else {
+        for (const QByteArray &type : types) {
+            QueryScheduler::instance(server)->addQuestion(this, type, PTR, cache);
+        }
+    }
+
+    // Pull the existing services from the cache
+    QTimer::singleShot(0, this, &BrowserPrivate::onCacheTimeout);
+}
+
+BrowserPrivate::~BrowserPrivate()
+{
+    if (dispatcher) {
+        dispatcher->unsubscribe(this);
+    }
+}
+
+bool BrowserPrivate::isBrowsed(const QByteArray &type) const
+{
+    return any ? type != MdnsBrowseType : types.contains(type);
 }
 
 // TODO: multiple SRV records not supported
 
 bool BrowserPrivate::updateService(const QByteArray &fqName)
 {
+    QMDNSENGINE_TRACE_SPAN("updateService", "mdns");
+
     // Split the FQDN into service name and type
     int index = fqName.indexOf('.');
     QByteArray serviceName = fqName.left(index);
     QByteArray serviceType = fqName.mid(index + 1);
 
+    // Ignore services of other types, a shared cache also holds their records
+    if (!isBrowsed(serviceType)) {
+        return false;
+    }
+
     // Immediately return if a PTR record does not exist
     Record ptrRecord;
     if (!cache->lookupRecord(serviceType, PTR, ptrRecord)) {
@@ -100,44 +145,64 @@ bool BrowserPrivate::updateService(const QByteArray &fqName)
 
     // If the service existed, this is an update; otherwise it is a new
     // addition; emit the appropriate signal
-    if (!services.contains(fqName)) {
+    QMap<QByteArray, Service> &typeServices = services[serviceType];
+    if (!typeServices.contains(fqName)) {
         emit q->serviceAdded(service);
-    } else if(services.value(fqName) != service) {
+    } else if(typeServices.value(fqName) != service) {
         emit q->serviceUpdated(service);
     }
 
-    services.insert(fqName, service);
+    typeServices.insert(fqName, service);
 
     return false;
 }
 
-void BrowserPrivate::onMessageReceived(const Message &message)
+void BrowserPrivate::removeService(const QByteArray &fqName)
 {
-    if (!message.isResponse()) {
+    QByteArray serviceType = fqName.mid(fqName.indexOf('.') + 1);
+    auto typeServices = services.find(serviceType);
+    if (typeServices == services.end()) {
         return;
     }
 
+    Service service = typeServices->take(fqName);
+    if (!service.name().isNull()) {
+        emit q->serviceRemoved(service);
+    }
+
+    // Forget the type until services of it are found again
+    if (typeServices->isEmpty()) {
+        services.erase(typeServices);
+    }
+}
+
+void BrowserPrivate::dispatchRecords(const Message &message, const QList<Record> &records)
+{
+    QMDNSENGINE_TRACE_SPAN("browse", "mdns");
+
     // Use a set to track all services that are updated in the message to
     // prevent unnecessary queries for SRV and TXT records
     QSet<QByteArray> updateNames;
-    const auto records = message.records();
     for (const Record &record : records) {
-        cache->addRecord(record);
-        bool any = type == MdnsBrowseType;
+        cache->addRecord(record, message.address());
         switch (record.type()) {
         case PTR:
             if (any && record.name() == MdnsBrowseType) {
+                // Keep the records of the discovered types over others
+                // when the cache has to evict records
+                if (record.ttl()) {
+                    cache->addWatchedType(record.target());
+                }
                 ptrTargets.insert(record.target());
                 serviceTimer.start();
-            } else if (any || record.name() == type) {
+            } else if (isBrowsed(record.name())) {
                 updateNames.insert(record.target());
             }
             break;
         case SRV:
         case TXT:
-            if (any || record.name().endsWith("." + type)) {
-                updateNames.insert(record.name());
-            }
+            // The type is checked by updateService()
+            updateNames.insert(record.name());
             break;
         }
     }
@@ -198,33 +263,25 @@ void BrowserPrivate::onRecordExpired(const Record &record)
     default:
         return;
     }
-    Service service = services.value(serviceName);
-    if (!service.name().isNull()) {
-        emit q->serviceRemoved(service);
-        services.remove(serviceName);
-    }
+    removeService(serviceName);
 }
 
-void BrowserPrivate::onQueryTimeout()
+void BrowserPrivate::onCacheTimeout()
 {
-    Query query;
-    query.setName(type);
-    query.setType(PTR);
-    Message message;
-    message.addQuery(query);
-
-    // TODO: including too many records could cause problems
-
-    // Include PTR records for the target that are already known
-    QList<Record> records;
-    if (cache->lookupRecords(query.name(), PTR, records)) {
+    // The cache may already contain records, for example when it is shared
+    // or was restored after a restart, so add the services they describe
+    QList<QByteArray> names = any ? QList<QByteArray>{QByteArray()} : types.values();
+    for (const QByteArray &name : qAsConst(names)) {
+        QList<Record> records;
+        cache->lookupRecords(name, PTR, records);
         for (const Record &record : qAsConst(records)) {
-            message.addRecord(record);
+            if (record.name() != MdnsBrowseType) {
+                updateService(record.target());
+            } else if (any) {
+                cache->addWatchedType(record.target());
+            }
         }
     }
-
-    server->sendMessageToAll(message);
-    queryTimer.start();
 }
 
 void BrowserPrivate::onServiceTimeout()
@@ -255,6 +312,12 @@ void BrowserPrivate::onServiceTimeout()
 
 Browser::Browser(AbstractServer *server, const QByteArray &type, Cache *cache, QObject *parent)
     : QObject(parent),
-      d(new BrowserPrivate(this, server, type, cache))
+      d(new BrowserPrivate(this, server, QList<QByteArray>{type}, cache))
+{
+}
+
+Browser::Browser(AbstractServer *server, const QList<QByteArray> &types, Cache *cache, QObject *parent)
+    : QObject(parent),
+      d(new BrowserPrivate(this, server, types, cache))
 {
 }
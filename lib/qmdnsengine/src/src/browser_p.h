@@ -26,13 +26,18 @@
 #define QMDNSENGINE_BROWSER_P_H
 
 #include <QByteArray>
+#include <QHash>
+#include <QList>
 #include <QMap>
 #include <QObject>
+#include <QPointer>
 #include <QSet>
 #include <QTimer>
 
 #include <qmdnsengine/service.h>
 
+#include "dispatcher_p.h"
+
 namespace QMdnsEngine
 {
 
@@ -42,33 +47,40 @@ class Cache;
 class Message;
 class Record;
 
-class BrowserPrivate : public QObject
+class BrowserPrivate : public QObject, public Dispatcher::Subscriber
 {
     Q_OBJECT
 
 public:
 
-    explicit BrowserPrivate(Browser *browser, AbstractServer *server, const QByteArray &type, Cache *existingCache);
+    explicit BrowserPrivate(Browser *browser, AbstractServer *server, const QList<QByteArray> &types, Cache *existingCache);
+    virtual ~BrowserPrivate();
 
+    bool isBrowsed(const QByteArray &type) const;
     bool updateService(const QByteArray &fqName);
+    void removeService(const QByteArray &fqName);
+
+    virtual void dispatchRecords(const Message &message, const QList<Record> &records);
 
     AbstractServer *server;
-    QByteArray type;
+    QPointer<Dispatcher> dispatcher;
+    QSet<QByteArray> types;
+    bool any;
 
     Cache *cache;
     QSet<QByteArray> ptrTargets;
-    QMap<QByteArray, Service> services;
 
-    QTimer queryTimer;
+    // Services by type, a type is only added once its first service is found
+    QHash<QByteArray, QMap<QByteArray, Service>> services;
+
     QTimer serviceTimer;
 
 private Q_SLOTS:
 
-    void onMessageReceived(const Message &message);
     void onShouldQuery(const Record &record);
     void onRecordExpired(const Record &record);
 
-    void onQueryTimeout();
+    void onCacheTimeout();
     void onServiceTimeout();
 
 private:
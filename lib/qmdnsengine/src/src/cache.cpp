@@ -28,20 +28,222 @@
 #define USE_QRANDOMGENERATOR
 #endif
 
+#include <QDataStream>
+
+#include <algorithm>
+
 #include <qmdnsengine/cache.h>
 #include <qmdnsengine/dns.h>
+#include <qmdnsengine/trace.h>
 
 #include "cache_p.h"
 
 using namespace QMdnsEngine;
 
+// Identifies the format written by Cache::saveRecords()
+static const quint32 SnapshotMagic = 0x514d4443;
+static const quint8 SnapshotVersion = 1;
+
+// Approximate memory used by an entry in addition to its variable data
+static const qint64 EntryOverhead = 256;
+
 CachePrivate::CachePrivate(Cache *cache)
     : QObject(cache),
+      count(0),
+      maximumEntries(-1),
+      maximumSize(-1),
+      maximumEntriesPerSource(-1),
+      size(0),
+      clock(0),
+      evictions(0),
+      rejections(0),
+      hits(0),
+      misses(0),
+      inserts(0),
+      replacements(0),
+      expirations(0),
       q(cache)
 {
     connect(&timer, &QTimer::timeout, this, &CachePrivate::onTimeout);
+    connect(&statsTimer, &QTimer::timeout, this, &CachePrivate::onStatsTimeout);
 
     timer.setSingleShot(true);
+
+    lruLists[false] = {nullptr, nullptr};
+    lruLists[true] = {nullptr, nullptr};
+}
+
+CachePrivate::~CachePrivate()
+{
+    for (const LruList &list : lruLists) {
+        for (Entry *entry = list.first; entry;) {
+            Entry *next = entry->next;
+            delete entry;
+            entry = next;
+        }
+    }
+}
+
+qint64 CachePrivate::recordSize(const Record &record)
+{
+    qint64 size = EntryOverhead + record.name().size() + record.target().size() +
+        record.nextDomainName().size() + record.bitmap().length();
+    const auto attributes = record.attributes();
+    for (auto i = attributes.constBegin(); i != attributes.constEnd(); ++i) {
+        size += i.key().size() + i.value().size();
+    }
+    return size;
+}
+
+void CachePrivate::insert(const Entry &entry)
+{
+    Entry *newEntry = new Entry(entry);
+    newEntry->watched = isWatched(entry.record);
+    link(newEntry);
+    names[entry.record.name()].append(newEntry);
+
+    ++count;
+    size += entry.size;
+    if (!entry.source.isNull()) {
+        ++sourceEntries[entry.source];
+    }
+}
+
+void CachePrivate::remove(Entry *entry)
+{
+    unlink(entry);
+    auto i = names.find(entry->record.name());
+    if (i != names.end()) {
+        i->removeOne(entry);
+        if (i->isEmpty()) {
+            names.erase(i);
+        }
+    }
+
+    --count;
+    size -= entry->size;
+    if (!entry->source.isNull() && --sourceEntries[entry->source] == 0) {
+        sourceEntries.remove(entry->source);
+    }
+    delete entry;
+}
+
+void CachePrivate::link(Entry *entry)
+{
+    // Append the entry as the most recently used one
+    LruList &list = lruLists[entry->watched];
+    entry->previous = list.last;
+    entry->next = nullptr;
+    if (list.last) {
+        list.last->next = entry;
+    } else {
+        list.first = entry;
+    }
+    list.last = entry;
+}
+
+void CachePrivate::unlink(Entry *entry)
+{
+    LruList &list = lruLists[entry->watched];
+    if (entry->previous) {
+        entry->previous->next = entry->next;
+    } else {
+        list.first = entry->next;
+    }
+    if (entry->next) {
+        entry->next->previous = entry->previous;
+    } else {
+        list.last = entry->previous;
+    }
+    entry->previous = nullptr;
+    entry->next = nullptr;
+}
+
+void CachePrivate::touch(Entry *entry)
+{
+    entry->lastUsed = ++clock;
+    unlink(entry);
+    link(entry);
+}
+
+QList<CachePrivate::Entry*> CachePrivate::allEntries() const
+{
+    // Only for callers that remove entries or emit signals while iterating,
+    // the others walk the lists directly
+    QList<Entry*> entries;
+    entries.reserve(count);
+    for (const LruList &list : lruLists) {
+        for (Entry *entry = list.first; entry; entry = entry->next) {
+            entries.append(entry);
+        }
+    }
+    return entries;
+}
+
+bool CachePrivate::isWatched(const Record &record) const
+{
+    // Without watched types every record is considered to be in use
+    if (watchedTypes.isEmpty()) {
+        return true;
+    }
+
+    // Resolvers rely on address records regardless of the service type
+    if (record.type() == A || record.type() == AAAA) {
+        return true;
+    }
+
+    // Check the record name (PTR) and the name of its service (SRV, TXT)
+    // against the watched types
+    QByteArray name = record.name();
+    if (watchedTypes.contains(name)) {
+        return true;
+    }
+    int index = name.indexOf('.');
+    return index != -1 && watchedTypes.contains(name.mid(index + 1));
+}
+
+void CachePrivate::updateWatched()
+{
+    // Rebuild both lists in the order the entries were last used, since
+    // entries can move from one list to the other
+    QList<Entry*> entries = allEntries();
+    std::sort(entries.begin(), entries.end(), [](const Entry *a, const Entry *b) {
+        return a->lastUsed < b->lastUsed;
+    });
+
+    lruLists[false] = {nullptr, nullptr};
+    lruLists[true] = {nullptr, nullptr};
+    for (Entry *entry : qAsConst(entries)) {
+        entry->watched = isWatched(entry->record);
+        link(entry);
+    }
+}
+
+void CachePrivate::evict()
+{
+    // Remove records until the cache is within its limits, starting with the
+    // least recently used record of a type that nobody is watching and then
+    // continuing with the least recently used record of any type
+    while ((maximumEntries >= 0 && count > maximumEntries) ||
+            (maximumSize >= 0 && size > maximumSize)) {
+        Entry *victim = lruLists[false].first ? lruLists[false].first : lruLists[true].first;
+        if (!victim) {
+            break;
+        }
+
+        // Report the record like an expired one, so that browsers forget
+        // the service it described; addresses are still valid and would be
+        // lost by the clients of resolvers, so query them again instead and
+        // let the answer add them back
+        Record record = victim->record;
+        remove(victim);
+        ++evictions;
+        if (record.type() == A || record.type() == AAAA) {
+            emit q->shouldQuery(record);
+        } else {
+            emit q->recordExpired(record);
+        }
+    }
 }
 
 void CachePrivate::onTimeout()
@@ -52,7 +254,8 @@ void CachePrivate::onTimeout()
     QDateTime now = QDateTime::currentDateTime();
     QDateTime newNextTrigger;
 
-    for (auto i = entries.begin(); i != entries.end();) {
+    const auto entries = allEntries();
+    for (Entry *i : entries) {
 
         // Loop through the triggers and remove ones that have already
         // passed
@@ -75,10 +278,11 @@ void CachePrivate::onTimeout()
             if (shouldQuery) {
                 emit q->shouldQuery(i->record);
             }
-            ++i;
         } else {
-            emit q->recordExpired(i->record);
-            i = entries.erase(i);
+            Record record = i->record;
+            remove(i);
+            ++expirations;
+            emit q->recordExpired(record);
         }
     }
 
@@ -90,38 +294,92 @@ void CachePrivate::onTimeout()
     }
 }
 
+void CachePrivate::onStatsTimeout()
+{
+    emit q->statsUpdated(q->stats());
+}
+
 Cache::Cache(QObject *parent)
     : QObject(parent),
       d(new CachePrivate(this))
 {
 }
 
-void Cache::addRecord(const Record &record)
+void Cache::setMaximumEntries(int entries)
+{
+    d->maximumEntries = entries;
+    d->evict();
+}
+
+void Cache::setMaximumSize(qint64 size)
+{
+    d->maximumSize = size;
+    d->evict();
+}
+
+void Cache::setMaximumEntriesPerSource(int entries)
+{
+    d->maximumEntriesPerSource = entries;
+}
+
+void Cache::setStatsInterval(int msec)
+{
+    if (msec > 0) {
+        d->statsTimer.start(msec);
+    } else {
+        d->statsTimer.stop();
+    }
+}
+
+void Cache::addWatchedType(const QByteArray &type)
 {
+    // Rebuilding the lists is only needed for new types
+    if (d->watchedTypes.contains(type)) {
+        return;
+    }
+    d->watchedTypes.insert(type);
+    d->updateWatched();
+}
+
+void Cache::addRecord(const Record &record, const QHostAddress &source)
+{
+    QMDNSENGINE_TRACE_SPAN("cacheInsert", "mdns");
+
     // If a record exists that matches, remove it from the cache; if the TTL
-    // is nonzero, it will be added back to the cache with updated times
-    for (auto i = d->entries.begin(); i != d->entries.end();) {
+    // is nonzero, it will be added back to the cache with updated times; a
+    // matching record always has the same name, so only those are checked
+    const QList<CachePrivate::Entry*> entries = d->names.value(record.name());
+    for (CachePrivate::Entry *i : entries) {
         if ((record.flushCache() &&
-                (*i).record.name() == record.name() &&
-                (*i).record.type() == record.type()) ||
-                (*i).record == record) {
+                i->record.name() == record.name() &&
+                i->record.type() == record.type()) ||
+                i->record == record) {
 
             // If the TTL is set to 0, indicate that the record was removed
             if (record.ttl() == 0) {
-                emit recordExpired((*i).record);
-            }
+                Record expired = i->record;
+                d->remove(i);
+                ++d->expirations;
+                emit recordExpired(expired);
 
-            i = d->entries.erase(i);
-
-            // No need to continue further if the TTL was set to 0
-            if (record.ttl() == 0) {
+                // No need to continue further if the TTL was set to 0
                 return;
             }
-        } else {
-            ++i;
+
+            if (i->record != record) {
+                ++d->replacements;
+            }
+            d->remove(i);
         }
     }
 
+    // Refuse new records from a source that already filled its quota
+    if (!source.isNull() && d->maximumEntriesPerSource >= 0 &&
+            d->sourceEntries.value(source) >= d->maximumEntriesPerSource) {
+        ++d->rejections;
+        return;
+    }
+
     // Use the current time to calculate the triggers and add a random offset
     QDateTime now = QDateTime::currentDateTime();
 #ifdef USE_QRANDOMGENERATOR
@@ -138,8 +396,10 @@ void Cache::addRecord(const Record &record)
         now.addSecs(record.ttl())
     };
 
-    // Append the record and its triggers
-    d->entries.append({record, triggers});
+    // Append the record and its triggers and make room for it if needed
+    d->insert({record, triggers, source, CachePrivate::recordSize(record), ++d->clock, false, nullptr, nullptr});
+    ++d->inserts;
+    d->evict();
 
     // Check if the new record's first trigger is earlier than the next
     // scheduled trigger; if so, restart the timer
@@ -149,7 +409,7 @@ void Cache::addRecord(const Record &record)
     }
 }
 
-bool Cache::lookupRecord(const QByteArray &name, quint16 type, Record &record) const
+bool Cache::lookupRecord(const QByteArray &name, quint16 type, Record &record)
 {
     QList<Record> records;
     if (lookupRecords(name, type, records)) {
@@ -159,15 +419,126 @@ bool Cache::lookupRecord(const QByteArray &name, quint16 type, Record &record) c
     return false;
 }
 
-bool Cache::lookupRecords(const QByteArray &name, quint16 type, QList<Record> &records) const
+bool Cache::lookupRecords(const QByteArray &name, quint16 type, QList<Record> &records)
 {
-    bool recordsAdded = false;
-    for (const CachePrivate::Entry &entry : d->entries) {
-        if ((name.isNull() || entry.record.name() == name) &&
-                (type == ANY || entry.record.type() == type)) {
-            records.append(entry.record);
-            recordsAdded = true;
+    // Collect the matching entries first, since marking them as used moves
+    // them within the lists
+    QList<CachePrivate::Entry*> matches;
+    auto match = [&](CachePrivate::Entry *entry) {
+        if (type == ANY || entry->record.type() == type) {
+            matches.append(entry);
+        }
+    };
+    if (name.isNull()) {
+        for (const CachePrivate::LruList &list : d->lruLists) {
+            for (CachePrivate::Entry *entry = list.first; entry; entry = entry->next) {
+                match(entry);
+            }
         }
+    } else {
+        const auto i = d->names.constFind(name);
+        if (i != d->names.constEnd()) {
+            for (CachePrivate::Entry *entry : *i) {
+                match(entry);
+            }
+        }
+    }
+
+    for (CachePrivate::Entry *entry : qAsConst(matches)) {
+        records.append(entry->record);
+
+        // Keep track of when the record was last used for eviction
+        d->touch(entry);
+    }
+
+    bool recordsAdded = !matches.isEmpty();
+    if (recordsAdded) {
+        ++d->hits;
+    } else {
+        ++d->misses;
     }
     return recordsAdded;
 }
+
+Cache::Stats Cache::stats() const
+{
+    Stats stats;
+    stats.entries = d->count;
+    stats.size = d->size;
+    stats.evictions = d->evictions;
+    stats.rejections = d->rejections;
+    stats.hits = d->hits;
+    stats.misses = d->misses;
+    stats.inserts = d->inserts;
+    stats.replacements = d->replacements;
+    stats.expirations = d->expirations;
+
+    // The last trigger of each record is its expiry, the others are refreshes
+    stats.pendingTriggers = 0;
+    for (const CachePrivate::LruList &list : d->lruLists) {
+        for (const CachePrivate::Entry *entry = list.first; entry; entry = entry->next) {
+            ++stats.entriesByType[entry->record.type()];
+            stats.pendingTriggers += entry->triggers.count() - 1;
+        }
+    }
+    return stats;
+}
+
+void Cache::saveRecords(QDataStream &stream) const
+{
+    stream << SnapshotMagic << SnapshotVersion << static_cast<quint32>(d->count);
+    for (const CachePrivate::LruList &list : d->lruLists) {
+        for (const CachePrivate::Entry *entry = list.first; entry; entry = entry->next) {
+
+            // Each record gets its own name map, since name compression only
+            // works within a single packet
+            QByteArray packet;
+            quint16 offset = 0;
+            QMap<QByteArray, quint16> nameMap;
+            Record record = entry->record;
+            writeRecord(packet, offset, record, nameMap);
+
+            // The last trigger is the time at which the record expires
+            stream << entry->triggers.last().toMSecsSinceEpoch() << packet;
+        }
+    }
+}
+
+bool Cache::loadRecords(QDataStream &stream)
+{
+    quint32 magic, count;
+    quint8 version;
+    stream >> magic >> version >> count;
+    if (stream.status() != QDataStream::Ok || magic != SnapshotMagic || version != SnapshotVersion) {
+        return false;
+    }
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (quint32 i = 0; i < count; ++i) {
+        qint64 expiry;
+        QByteArray packet;
+        stream >> expiry >> packet;
+        if (stream.status() != QDataStream::Ok) {
+            return false;
+        }
+
+        Record record;
+        quint16 offset = 0;
+        if (!parseRecord(packet, offset, record)) {
+            continue;
+        }
+
+        // Skip records that expired while they were stored
+        qint64 ttl = (expiry - now) / 1000;
+        if (ttl <= 0) {
+            continue;
+        }
+
+        // The records were not received together, so they must not flush
+        // each other from the cache
+        record.setFlushCache(false);
+        record.setTtl(ttl);
+        addRecord(record);
+    }
+    return true;
+}
@@ -26,8 +26,12 @@
 #define QMDNSENGINE_CACHE_P_H
 
 #include <QDateTime>
+#include <QHash>
+#include <QHostAddress>
 #include <QList>
+#include <QMap>
 #include <QObject>
+#include <QSet>
 #include <QTimer>
 
 #include <qmdnsengine/record.h>
@@ -47,17 +51,72 @@ public:
     {
         Record record;
         QList<QDateTime> triggers;
+        QHostAddress source;
+        qint64 size;
+        quint64 lastUsed;
+        bool watched;
+
+        // Neighbours in the least recently used list of the entry
+        Entry *previous;
+        Entry *next;
+    };
+
+    // Entries ordered from least to most recently used
+    struct LruList
+    {
+        Entry *first;
+        Entry *last;
     };
 
     CachePrivate(Cache *cache);
+    virtual ~CachePrivate();
+
+    static qint64 recordSize(const Record &record);
+
+    void insert(const Entry &entry);
+    void remove(Entry *entry);
+    void link(Entry *entry);
+    void unlink(Entry *entry);
+    void touch(Entry *entry);
+    QList<Entry*> allEntries() const;
+    bool isWatched(const Record &record) const;
+    void updateWatched();
+    void evict();
 
     QTimer timer;
-    QList<Entry> entries;
+    QTimer statsTimer;
     QDateTime nextTrigger;
 
+    // Unwatched entries are evicted before watched ones, so each has its own
+    // list, indexed by whether the entries are watched
+    LruList lruLists[2];
+    int count;
+
+    // Entries by record name, so that lookups and updates of a name don't
+    // have to scan the whole cache
+    QHash<QByteArray, QList<Entry*>> names;
+
+    int maximumEntries;
+    qint64 maximumSize;
+    int maximumEntriesPerSource;
+    QSet<QByteArray> watchedTypes;
+
+    qint64 size;
+    quint64 clock;
+    QHash<QHostAddress, int> sourceEntries;
+
+    quint64 evictions;
+    quint64 rejections;
+    quint64 hits;
+    quint64 misses;
+    quint64 inserts;
+    quint64 replacements;
+    quint64 expirations;
+
 private Q_SLOTS:
 
     void onTimeout();
+    void onStatsTimeout();
 
 private:
 
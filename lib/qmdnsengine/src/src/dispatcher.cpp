@@ -0,0 +1,225 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <qmdnsengine/abstractserver.h>
+#include <qmdnsengine/cache.h>
+#include <qmdnsengine/message.h>
+#include <qmdnsengine/query.h>
+#include <qmdnsengine/record.h>
+
+#include "dispatcher_p.h"
+
+using namespace QMdnsEngine;
+
+void Dispatcher::Subscriber::dispatchRecords(const Message &, const QList<Record> &)
+{
+}
+
+void Dispatcher::Subscriber::dispatchQueries(const Message &)
+{
+}
+
+void Dispatcher::Subscriber::dispatchExpiredRecord(const Record &)
+{
+}
+
+Dispatcher::Dispatcher(AbstractServer *server)
+    : QObject(server)
+{
+    connect(server, &AbstractServer::messageReceived, this, &Dispatcher::onMessageReceived);
+}
+
+Dispatcher *Dispatcher::instance(AbstractServer *server)
+{
+    // There is exactly one dispatcher for each server, which is owned by the
+    // server and created the first time it is needed
+    Dispatcher *dispatcher = server->findChild<Dispatcher*>(QString(), Qt::FindDirectChildrenOnly);
+    if (!dispatcher) {
+        dispatcher = new Dispatcher(server);
+    }
+    return dispatcher;
+}
+
+void Dispatcher::subscribeRecords(Subscriber *subscriber, const QByteArray &name, quint16 type)
+{
+    subscribe(RecordIndex, subscriber, Key(name, type));
+}
+
+void Dispatcher::subscribeRecordSuffix(Subscriber *subscriber, const QByteArray &suffix, quint16 type)
+{
+    subscribe(SuffixIndex, subscriber, Key(suffix, type));
+}
+
+void Dispatcher::subscribeAllRecords(Subscriber *subscriber)
+{
+    if (!allRecords.contains(subscriber)) {
+        allRecords.append(subscriber);
+    }
+
+    // Make sure the subscriber is known even without indexed subscriptions
+    subscriptions[subscriber];
+}
+
+void Dispatcher::subscribeQueries(Subscriber *subscriber, const QByteArray &name, quint16 type)
+{
+    subscribe(QueryIndex, subscriber, Key(name, type));
+}
+
+void Dispatcher::subscribeExpiredRecords(Subscriber *subscriber, Cache *cache, const QByteArray &name, quint16 type)
+{
+    // Listen to each cache once, instead of every subscriber listening and
+    // filtering all of the expired records itself
+    if (!expiryIndexes.contains(cache)) {
+        connect(cache, &Cache::recordExpired, this, [this, cache](const Record &record) {
+            onRecordExpired(cache, record);
+        });
+        connect(cache, &QObject::destroyed, this, [this, cache]() {
+            expiryIndexes.remove(cache);
+        });
+    }
+
+    Key key(name, type);
+    QList<Subscriber*> &subscribers = expiryIndexes[cache][key];
+    if (!subscribers.contains(subscriber)) {
+        subscribers.append(subscriber);
+        expirySubscriptions[subscriber].append(qMakePair(cache, key));
+    }
+}
+
+void Dispatcher::subscribe(Index index, Subscriber *subscriber, const Key &key)
+{
+    QList<Subscriber*> &subscribers = indexes[index][key];
+    if (!subscribers.contains(subscriber)) {
+        subscribers.append(subscriber);
+        subscriptions[subscriber].append(qMakePair(index, key));
+    }
+}
+
+void Dispatcher::unsubscribe(Subscriber *subscriber)
+{
+    const auto keys = subscriptions.take(subscriber);
+    for (const auto &key : keys) {
+        auto i = indexes[key.first].find(key.second);
+        if (i != indexes[key.first].end()) {
+            i->removeAll(subscriber);
+            if (i->isEmpty()) {
+                indexes[key.first].erase(i);
+            }
+        }
+    }
+    allRecords.removeAll(subscriber);
+
+    const auto expiryKeys = expirySubscriptions.take(subscriber);
+    for (const auto &key : expiryKeys) {
+        auto i = expiryIndexes.find(key.first);
+        if (i == expiryIndexes.end()) {
+            continue;
+        }
+        auto j = i->find(key.second);
+        if (j != i->end()) {
+            j->removeAll(subscriber);
+            if (j->isEmpty()) {
+                i->erase(j);
+            }
+        }
+
+        // Stop listening to a cache without subscribers
+        if (i->isEmpty()) {
+            disconnect(key.first, nullptr, this, nullptr);
+            expiryIndexes.erase(i);
+        }
+    }
+}
+
+void Dispatcher::onRecordExpired(Cache *cache, const Record &record)
+{
+    const auto subscribers = expiryIndexes.value(cache).value(Key(record.name(), record.type()));
+
+    // Subscribers may unsubscribe while the record is being delivered
+    for (Subscriber *subscriber : subscribers) {
+        if (expirySubscriptions.contains(subscriber)) {
+            subscriber->dispatchExpiredRecord(record);
+        }
+    }
+}
+
+void Dispatcher::onMessageReceived(const Message &message)
+{
+    // Determine which subscribers are interested in the message, keeping the
+    // order in which they were found so that delivery is predictable
+    QList<Subscriber*> targets;
+
+    QHash<Subscriber*, QList<Record>> records;
+    if (message.isResponse()) {
+        const auto messageRecords = message.records();
+        for (const Record &record : messageRecords) {
+            QList<Subscriber*> subscribers = allRecords;
+            subscribers.append(indexes[RecordIndex].value(Key(record.name(), record.type())));
+
+            // Look up each of the suffixes of the name, starting at every "."
+            if (!indexes[SuffixIndex].isEmpty()) {
+                const QByteArray name = record.name();
+                for (int i = name.indexOf('.'); i != -1; i = name.indexOf('.', i + 1)) {
+                    subscribers.append(indexes[SuffixIndex].value(Key(name.mid(i), record.type())));
+                }
+            }
+
+            // A subscriber may match the same record more than once
+            QList<Subscriber*> recordTargets;
+            for (Subscriber *subscriber : qAsConst(subscribers)) {
+                if (recordTargets.contains(subscriber)) {
+                    continue;
+                }
+                recordTargets.append(subscriber);
+                if (!records.contains(subscriber)) {
+                    targets.append(subscriber);
+                }
+                records[subscriber].append(record);
+            }
+        }
+    } else {
+        const auto queries = message.queries();
+        for (const Query &query : queries) {
+            const auto subscribers = indexes[QueryIndex].value(Key(query.name(), query.type()));
+            for (Subscriber *subscriber : subscribers) {
+                if (!targets.contains(subscriber)) {
+                    targets.append(subscriber);
+                }
+            }
+        }
+    }
+
+    // Subscribers may unsubscribe (or be destroyed) while the message is
+    // being delivered, so check that each one is still subscribed
+    for (Subscriber *subscriber : qAsConst(targets)) {
+        if (!subscriptions.contains(subscriber)) {
+            continue;
+        }
+        if (message.isResponse()) {
+            subscriber->dispatchRecords(message, records.value(subscriber));
+        } else {
+            subscriber->dispatchQueries(message);
+        }
+    }
+}
@@ -0,0 +1,109 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef QMDNSENGINE_DISPATCHER_P_H
+#define QMDNSENGINE_DISPATCHER_P_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPair>
+
+namespace QMdnsEngine
+{
+
+class AbstractServer;
+class Cache;
+class Message;
+class Record;
+
+/**
+ * @brief Routes received messages to the objects interested in them
+ *
+ * Instead of every object inspecting every message, subscribers register the
+ * names and types they are interested in. Records in responses are indexed
+ * by name and type (or by name suffix and type) and each subscriber only
+ * receives the records that match one of its subscriptions. Queries are
+ * routed the same way, but the subscriber receives the complete message.
+ * Records that expire from a cache are routed by name and type as well, to
+ * the subscribers of that cache.
+ */
+class Dispatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    class Subscriber
+    {
+    public:
+
+        virtual ~Subscriber() {}
+
+        virtual void dispatchRecords(const Message &message, const QList<Record> &records);
+        virtual void dispatchQueries(const Message &message);
+        virtual void dispatchExpiredRecord(const Record &record);
+    };
+
+    static Dispatcher *instance(AbstractServer *server);
+
+    void subscribeRecords(Subscriber *subscriber, const QByteArray &name, quint16 type);
+    void subscribeRecordSuffix(Subscriber *subscriber, const QByteArray &suffix, quint16 type);
+    void subscribeAllRecords(Subscriber *subscriber);
+    void subscribeQueries(Subscriber *subscriber, const QByteArray &name, quint16 type);
+    void subscribeExpiredRecords(Subscriber *subscriber, Cache *cache, const QByteArray &name, quint16 type);
+    void unsubscribe(Subscriber *subscriber);
+
+private Q_SLOTS:
+
+    void onMessageReceived(const Message &message);
+
+private:
+
+    typedef QPair<QByteArray, quint16> Key;
+
+    enum Index {
+        RecordIndex,
+        SuffixIndex,
+        QueryIndex
+    };
+
+    explicit Dispatcher(AbstractServer *server);
+
+    void subscribe(Index index, Subscriber *subscriber, const Key &key);
+
+    QHash<Key, QList<Subscriber*>> indexes[3];
+    QList<Subscriber*> allRecords;
+    QHash<Subscriber*, QList<QPair<Index, Key>>> subscriptions;
+
+    void onRecordExpired(Cache *cache, const Record &record);
+
+    QHash<Cache*, QHash<Key, QList<Subscriber*>>> expiryIndexes;
+    QHash<Subscriber*, QList<QPair<Cache*, Key>>> expirySubscriptions;
+};
+
+}
+
+#endif // QMDNSENGINE_DISPATCHER_P_H
@@ -359,6 +359,62 @@ void toPacket(const Message &message, QByteArray &packet)
     }
 }
 
+static Message continueMessage(const Message &message, QByteArray &packet, quint16 &offset, QMap<QByteArray, quint16> &nameMap)
+{
+    // Start an empty message for the same destination and write its header
+    // to the packet that keeps track of its size
+    Message continuation;
+    continuation.setAddress(message.address());
+    continuation.setPort(message.port());
+    continuation.setTransactionId(message.transactionId());
+    packet.clear();
+    offset = 0;
+    nameMap.clear();
+    for (int i = 0; i < 6; ++i) {
+        writeInteger<quint16>(packet, offset, 0);
+    }
+    return continuation;
+}
+
+QList<Message> splitKnownAnswers(const Message &message, int maximumSize)
+{
+    QList<Message> messages;
+    QByteArray packet;
+    quint16 offset;
+    QMap<QByteArray, quint16> nameMap;
+
+    // The queries always go into the first message
+    Message current = continueMessage(message, packet, offset, nameMap);
+    const auto queries = message.queries();
+    for (const Query &query : queries) {
+        writeName(packet, offset, query.name(), nameMap);
+        writeInteger<quint16>(packet, offset, query.type());
+        writeInteger<quint16>(packet, offset, query.unicastResponse() ? 0x8001 : 1);
+        current.addQuery(query);
+    }
+    int contents = queries.count();
+
+    // Write each record to find out whether it still fits, and otherwise
+    // continue with it in the next message; a record that doesn't fit in an
+    // empty message is sent on its own
+    const auto records = message.records();
+    for (Record record : records) {
+        writeRecord(packet, offset, record, nameMap);
+        if (packet.length() > maximumSize && contents) {
+            current.setTruncated(true);
+            messages.append(current);
+            current = continueMessage(message, packet, offset, nameMap);
+            writeRecord(packet, offset, record, nameMap);
+            contents = 0;
+        }
+        current.addRecord(record);
+        ++contents;
+    }
+
+    messages.append(current);
+    return messages;
+}
+
 QString typeName(quint16 type)
 {
     switch (type) {
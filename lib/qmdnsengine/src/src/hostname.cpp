@@ -41,9 +41,9 @@ using namespace QMdnsEngine;
 HostnamePrivate::HostnamePrivate(Hostname *hostname, AbstractServer *server)
     : QObject(hostname),
       q(hostname),
-      server(server)
+      server(server),
+      dispatcher(Dispatcher::instance(server))
 {
-    connect(server, &AbstractServer::messageReceived, this, &HostnamePrivate::onMessageReceived);
     connect(&registrationTimer, &QTimer::timeout, this, &HostnamePrivate::onRegistrationTimeout);
     connect(&rebroadcastTimer, &QTimer::timeout, this, &HostnamePrivate::onRebroadcastTimeout);
 
@@ -57,6 +57,13 @@ HostnamePrivate::HostnamePrivate(Hostname *hostname, AbstractServer *server)
     onRebroadcastTimeout();
 }
 
+HostnamePrivate::~HostnamePrivate()
+{
+    if (dispatcher) {
+        dispatcher->unsubscribe(this);
+    }
+}
+
 void HostnamePrivate::assertHostname()
 {
     // Begin with the local hostname and replace any "." with "-" (I'm looking
@@ -69,6 +76,13 @@ void HostnamePrivate::assertHostname()
     hostname = (hostnameSuffix == 1 ? localHostname:
         localHostname + "-" + QByteArray::number(hostnameSuffix)) + ".local.";
 
+    // Only responses and queries for the hostname are of interest
+    dispatcher->unsubscribe(this);
+    dispatcher->subscribeRecords(this, hostname, A);
+    dispatcher->subscribeRecords(this, hostname, AAAA);
+    dispatcher->subscribeQueries(this, hostname, A);
+    dispatcher->subscribeQueries(this, hostname, AAAA);
+
     // Compose a query for A and AAAA records matching the hostname
     Query ipv4Query;
     ipv4Query.setName(hostname);
@@ -112,37 +126,37 @@ bool HostnamePrivate::generateRecord(const QHostAddress &srcAddress, quint16 typ
     return false;
 }
 
-void HostnamePrivate::onMessageReceived(const Message &message)
+void HostnamePrivate::dispatchRecords(const Message &, const QList<Record> &records)
 {
-    if (message.isResponse()) {
-        if (hostnameRegistered) {
-            return;
-        }
-        const auto records = message.records();
-        for (const Record &record : records) {
-            if ((record.type() == A || record.type() == AAAA) && record.name() == hostname) {
-                ++hostnameSuffix;
-                assertHostname();
-            }
-        }
-    } else {
-        if (!hostnameRegistered) {
-            return;
+    if (hostnameRegistered) {
+        return;
+    }
+    for (const Record &record : records) {
+        if ((record.type() == A || record.type() == AAAA) && record.name() == hostname) {
+            ++hostnameSuffix;
+            assertHostname();
         }
-        Message reply;
-        reply.reply(message);
-        const auto queries = message.queries();
-        for (const Query &query : queries) {
-            if ((query.type() == A || query.type() == AAAA) && query.name() == hostname) {
-                Record record;
-                if (generateRecord(message.address(), query.type(), record)) {
-                    reply.addRecord(record);
-                }
+    }
+}
+
+void HostnamePrivate::dispatchQueries(const Message &message)
+{
+    if (!hostnameRegistered) {
+        return;
+    }
+    Message reply;
+    reply.reply(message);
+    const auto queries = message.queries();
+    for (const Query &query : queries) {
+        if ((query.type() == A || query.type() == AAAA) && query.name() == hostname) {
+            Record record;
+            if (generateRecord(message.address(), query.type(), record)) {
+                reply.addRecord(record);
             }
         }
-        if (reply.records().count()) {
-            server->sendMessage(reply);
-        }
+    }
+    if (reply.records().count()) {
+        server->sendMessage(reply);
     }
 }
 
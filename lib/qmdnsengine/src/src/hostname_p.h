@@ -26,8 +26,11 @@
 #define QMDNSENGINE_HOSTNAME_P_H
 
 #include <QObject>
+#include <QPointer>
 #include <QTimer>
 
+#include "dispatcher_p.h"
+
 class QHostAddress;
 
 namespace QMdnsEngine
@@ -38,18 +41,23 @@ class Hostname;
 class Message;
 class Record;
 
-class HostnamePrivate : public QObject
+class HostnamePrivate : public QObject, public Dispatcher::Subscriber
 {
     Q_OBJECT
 
 public:
 
     HostnamePrivate(Hostname *hostname, AbstractServer *server);
+    virtual ~HostnamePrivate();
 
     void assertHostname();
     bool generateRecord(const QHostAddress &srcAddress, quint16 type, Record &record);
 
+    virtual void dispatchRecords(const Message &message, const QList<Record> &records);
+    virtual void dispatchQueries(const Message &message);
+
     AbstractServer *server;
+    QPointer<Dispatcher> dispatcher;
 
     QByteArray hostnamePrev;
     QByteArray hostname;
@@ -61,7 +69,6 @@ public:
 
 private Q_SLOTS:
 
-    void onMessageReceived(const Message &message);
     void onRegistrationTimeout();
     void onRebroadcastTimeout();
 
@@ -36,6 +36,7 @@ ProberPrivate::ProberPrivate(Prober *prober, AbstractServer *server, const Recor
     : QObject(prober),
       q(prober),
       server(server),
+      dispatcher(Dispatcher::instance(server)),
       confirmed(false),
       proposedRecord(record),
       suffix(1)
@@ -45,7 +46,6 @@ ProberPrivate::ProberPrivate(Prober *prober, AbstractServer *server, const Recor
     name = record.name().left(index);
     type = record.name().mid(index);
 
-    connect(server, &AbstractServer::messageReceived, this, &ProberPrivate::onMessageReceived);
     connect(&timer, &QTimer::timeout, this, &ProberPrivate::onTimeout);
 
     timer.setSingleShot(true);
@@ -53,12 +53,23 @@ ProberPrivate::ProberPrivate(Prober *prober, AbstractServer *server, const Recor
     assertRecord();
 }
 
+ProberPrivate::~ProberPrivate()
+{
+    if (dispatcher) {
+        dispatcher->unsubscribe(this);
+    }
+}
+
 void ProberPrivate::assertRecord()
 {
     // Use the current suffix to set the name of the proposed record
     proposedRecord.setName(suffix == 1 ?
         name + type : name + "-" + QByteArray::number(suffix) + type);
 
+    // Only responses containing the proposed record are of interest
+    dispatcher->unsubscribe(this);
+    dispatcher->subscribeRecords(this, proposedRecord.name(), proposedRecord.type());
+
     // Broadcast a query for the proposed name (using an ANY query) and
     // include the proposed record in the query
     Query query;
@@ -74,15 +85,14 @@ void ProberPrivate::assertRecord()
     timer.start(2 * 1000);
 }
 
-void ProberPrivate::onMessageReceived(const Message &message)
+void ProberPrivate::dispatchRecords(const Message &, const QList<Record> &records)
 {
     // If the response matches the proposed record, increment the suffix and
     // try with the new name
 
-    if (confirmed || !message.isResponse()) {
+    if (confirmed) {
         return;
     }
-    const auto records = message.records();
     for (const Record &record : records) {
         if (record.name() == proposedRecord.name() && record.type() == proposedRecord.type()) {
             ++suffix;
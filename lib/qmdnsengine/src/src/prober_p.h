@@ -26,10 +26,13 @@
 #define QMDNSENGINE_PROBER_P_H
 
 #include <QObject>
+#include <QPointer>
 #include <QTimer>
 
 #include <qmdnsengine/record.h>
 
+#include "dispatcher_p.h"
+
 namespace QMdnsEngine
 {
 
@@ -37,17 +40,21 @@ class AbstractServer;
 class Message;
 class Prober;
 
-class ProberPrivate : public QObject
+class ProberPrivate : public QObject, public Dispatcher::Subscriber
 {
     Q_OBJECT
 
 public:
 
     ProberPrivate(Prober *prober, AbstractServer *server, const Record &record);
+    virtual ~ProberPrivate();
 
     void assertRecord();
 
+    virtual void dispatchRecords(const Message &message, const QList<Record> &records);
+
     AbstractServer *server;
+    QPointer<Dispatcher> dispatcher;
     QTimer timer;
 
     bool confirmed;
@@ -59,7 +66,6 @@ public:
 
 private Q_SLOTS:
 
-    void onMessageReceived(const Message &message);
     void onTimeout();
 
 private:
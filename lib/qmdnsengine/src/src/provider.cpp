@@ -38,12 +38,12 @@ using namespace QMdnsEngine;
 ProviderPrivate::ProviderPrivate(QObject *parent, AbstractServer *server, Hostname *hostname)
     : QObject(parent),
       server(server),
+      dispatcher(Dispatcher::instance(server)),
       hostname(hostname),
       prober(nullptr),
       initialized(false),
       confirmed(false)
 {
-    connect(server, &AbstractServer::messageReceived, this, &ProviderPrivate::onMessageReceived);
     connect(hostname, &Hostname::hostnameChanged, this, &ProviderPrivate::onHostnameChanged);
 
     browsePtrProposed.setName(MdnsBrowseType);
@@ -58,6 +58,9 @@ ProviderPrivate::~ProviderPrivate()
     if (confirmed) {
         farewell();
     }
+    if (dispatcher) {
+        dispatcher->unsubscribe(this);
+    }
 }
 
 void ProviderPrivate::announce()
@@ -123,11 +126,18 @@ void ProviderPrivate::publish()
     srvRecord = srvProposed;
     txtRecord = txtProposed;
     announce();
+
+    // Only queries for the published records are of interest
+    dispatcher->unsubscribe(this);
+    dispatcher->subscribeQueries(this, MdnsBrowseType, PTR);
+    dispatcher->subscribeQueries(this, ptrRecord.name(), PTR);
+    dispatcher->subscribeQueries(this, srvRecord.name(), SRV);
+    dispatcher->subscribeQueries(this, txtRecord.name(), TXT);
 }
 
-void ProviderPrivate::onMessageReceived(const Message &message)
+void ProviderPrivate::dispatchQueries(const Message &message)
 {
-    if (!confirmed || message.isResponse()) {
+    if (!confirmed) {
         return;
     }
 
@@ -26,10 +26,13 @@
 #define QMDNSENGINE_PROVIDER_P_H
 
 #include <QObject>
+#include <QPointer>
 
 #include <qmdnsengine/record.h>
 #include <qmdnsengine/service.h>
 
+#include "dispatcher_p.h"
+
 namespace QMdnsEngine
 {
 
@@ -38,7 +41,7 @@ class Hostname;
 class Message;
 class Prober;
 
-class ProviderPrivate : public QObject
+class ProviderPrivate : public QObject, public Dispatcher::Subscriber
 {
     Q_OBJECT
 
@@ -52,7 +55,10 @@ public:
     void farewell();
     void publish();
 
+    virtual void dispatchQueries(const Message &message);
+
     AbstractServer *server;
+    QPointer<Dispatcher> dispatcher;
     Hostname *hostname;
     Prober *prober;
 
@@ -72,7 +78,6 @@ public:
 
 private Q_SLOTS:
 
-    void onMessageReceived(const Message &message);
     void onHostnameChanged(const QByteArray &hostname);
 };
 
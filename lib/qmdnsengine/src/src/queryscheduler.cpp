@@ -0,0 +1,217 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QDateTime>
+#include <QSet>
+
+#include <qmdnsengine/abstractserver.h>
+#include <qmdnsengine/cache.h>
+#include <qmdnsengine/dns.h>
+#include <qmdnsengine/mdns.h>
+#include <qmdnsengine/message.h>
+#include <qmdnsengine/query.h>
+#include <qmdnsengine/record.h>
+
+#include "queryscheduler_p.h"
+
+using namespace QMdnsEngine;
+
+// Intervals between successive queries for the same question
+static const qint64 MinimumInterval = 1000;
+static const qint64 MaximumInterval = 60 * 60 * 1000;
+
+// Maximum number of questions to include in a single message
+static const int MaximumQueries = 16;
+
+QueryScheduler::QueryScheduler(AbstractServer *server)
+    : QObject(server),
+      server(server)
+{
+    connect(server, &AbstractServer::interfacesChanged, this, &QueryScheduler::reset);
+    connect(&timer, &QTimer::timeout, this, &QueryScheduler::onTimeout);
+
+    timer.setSingleShot(true);
+}
+
+QueryScheduler *QueryScheduler::instance(AbstractServer *server)
+{
+    // There is exactly one scheduler for each server, which is owned by the
+    // server and created the first time it is needed
+    QueryScheduler *scheduler = server->findChild<QueryScheduler*>(QString(), Qt::FindDirectChildrenOnly);
+    if (!scheduler) {
+        scheduler = new QueryScheduler(server);
+    }
+    return scheduler;
+}
+
+void QueryScheduler::addQuestion(QObject *owner, const QByteArray &name, quint16 type, Cache *cache)
+{
+    // New questions are queried as soon as control returns to the event loop
+    // so that questions added at the same time end up in the same message
+    Key key(name, type);
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (!questions.contains(key)) {
+        questions.insert(key, {{}, MinimumInterval, now});
+    }
+    Question &question = questions[key];
+
+    // An owner with a cache that none of the other owners use has not seen
+    // the answers yet, so start over with the shortest interval; owners
+    // sharing a cache find the answers in it
+    bool newCache = true;
+    for (const auto &other : qAsConst(question.owners)) {
+        if (other.second == cache) {
+            newCache = false;
+            break;
+        }
+    }
+    if (newCache) {
+        question.interval = MinimumInterval;
+        question.nextQuery = now;
+    }
+    question.owners.append(qMakePair(owner, cache));
+
+    connect(owner, &QObject::destroyed, this, &QueryScheduler::onOwnerDestroyed, Qt::UniqueConnection);
+
+    schedule();
+}
+
+void QueryScheduler::removeQuestions(QObject *owner)
+{
+    for (auto i = questions.begin(); i != questions.end();) {
+        for (auto j = i->owners.begin(); j != i->owners.end();) {
+            if (j->first == owner) {
+                j = i->owners.erase(j);
+            } else {
+                ++j;
+            }
+        }
+        if (i->owners.isEmpty()) {
+            i = questions.erase(i);
+        } else {
+            ++i;
+        }
+    }
+
+    disconnect(owner, &QObject::destroyed, this, &QueryScheduler::onOwnerDestroyed);
+
+    schedule();
+}
+
+void QueryScheduler::reset()
+{
+    // Start over with the shortest interval, since the network may have
+    // changed and none of the previous answers can be assumed to be complete
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (auto i = questions.begin(); i != questions.end(); ++i) {
+        i->interval = MinimumInterval;
+        i->nextQuery = now;
+    }
+
+    schedule();
+}
+
+void QueryScheduler::schedule()
+{
+    // Start the timer for the question that is due first
+    qint64 nextQuery = -1;
+    for (auto i = questions.constBegin(); i != questions.constEnd(); ++i) {
+        if (nextQuery < 0 || i->nextQuery < nextQuery) {
+            nextQuery = i->nextQuery;
+        }
+    }
+
+    if (nextQuery < 0) {
+        timer.stop();
+    } else {
+        timer.start(qMax<qint64>(0, nextQuery - QDateTime::currentMSecsSinceEpoch()));
+    }
+}
+
+void QueryScheduler::send(const Message &message)
+{
+    // Known answers that don't fit in a single packet continue in the
+    // following ones, which the responders wait for
+    const auto messages = splitKnownAnswers(message, MdnsMaximumPacketSize);
+    for (const Message &part : messages) {
+        server->sendMessageToAll(part);
+    }
+}
+
+void QueryScheduler::onTimeout()
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    Message message;
+    int queries = 0;
+    for (auto i = questions.begin(); i != questions.end(); ++i) {
+        if (i->nextQuery > now) {
+            continue;
+        }
+
+        Query query;
+        query.setName(i.key().first);
+        query.setType(i.key().second);
+        message.addQuery(query);
+
+        // Include the records that are already known, looking in each of
+        // the caches used by the owners only once
+        QSet<Cache*> caches;
+        for (const auto &owner : qAsConst(i->owners)) {
+            if (caches.contains(owner.second)) {
+                continue;
+            }
+            caches.insert(owner.second);
+
+            QList<Record> records;
+            if (owner.second->lookupRecords(query.name(), query.type(), records)) {
+                for (const Record &record : qAsConst(records)) {
+                    message.addRecord(record);
+                }
+            }
+        }
+
+        // Double the interval until the maximum is reached
+        i->nextQuery = now + i->interval;
+        i->interval = qMin(i->interval * 2, MaximumInterval);
+
+        // Limit the number of questions in each message
+        if (++queries == MaximumQueries) {
+            send(message);
+            message = Message();
+            queries = 0;
+        }
+    }
+
+    if (queries) {
+        send(message);
+    }
+
+    schedule();
+}
+
+void QueryScheduler::onOwnerDestroyed(QObject *owner)
+{
+    removeQuestions(owner);
+}
@@ -0,0 +1,93 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef QMDNSENGINE_QUERYSCHEDULER_P_H
+#define QMDNSENGINE_QUERYSCHEDULER_P_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QTimer>
+
+namespace QMdnsEngine
+{
+
+class AbstractServer;
+class Cache;
+class Message;
+
+/**
+ * @brief Shared scheduler for continuous queries
+ *
+ * Every question (name and type) is queried immediately, then again after
+ * one second with the interval doubling up to a maximum of one hour, as
+ * recommended by RFC 6762 section 5.2. All questions for a server share a
+ * single timer and questions that are due at the same time are sent in the
+ * same message together with the known answers from their caches. Known
+ * answers that exceed the size of a packet are continued in further packets
+ * with the TC bit set (RFC 6762 section 7.2).
+ */
+class QueryScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    static QueryScheduler *instance(AbstractServer *server);
+
+    void addQuestion(QObject *owner, const QByteArray &name, quint16 type, Cache *cache);
+    void removeQuestions(QObject *owner);
+    void reset();
+
+private Q_SLOTS:
+
+    void onTimeout();
+    void onOwnerDestroyed(QObject *owner);
+
+private:
+
+    typedef QPair<QByteArray, quint16> Key;
+
+    struct Question
+    {
+        QList<QPair<QObject*, Cache*>> owners;
+        qint64 interval;
+        qint64 nextQuery;
+    };
+
+    explicit QueryScheduler(AbstractServer *server);
+
+    void schedule();
+    void send(const Message &message);
+
+    AbstractServer *server;
+    QTimer timer;
+    QHash<Key, Question> questions;
+};
+
+}
+
+#endif // QMDNSENGINE_QUERYSCHEDULER_P_H
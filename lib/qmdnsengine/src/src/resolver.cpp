@@ -32,6 +32,7 @@
 #include <qmdnsengine/record.h>
 #include <qmdnsengine/resolver.h>
 
+#include "queryscheduler_p.h"
 #include "resolver_p.h"
 
 using namespace QMdnsEngine;
@@ -40,20 +41,34 @@ ResolverPrivate::ResolverPrivate(Resolver *resolver, AbstractServer *server, con
     : QObject(resolver),
       q(resolver),
       server(server),
+      dispatcher(Dispatcher::instance(server)),
       name(name),
       cache(cache ? cache : new Cache(this))
 {
-    connect(server, &AbstractServer::messageReceived, this, &ResolverPrivate::onMessageReceived);
+    dispatcher->subscribeRecords(this, name, A);
+    dispatcher->subscribeRecords(this, name, AAAA);
+    dispatcher->subscribeExpiredRecords(this, this->cache, name, A);
+    dispatcher->subscribeExpiredRecords(this, this->cache, name, AAAA);
     connect(&timer, &QTimer::timeout, this, &ResolverPrivate::onTimeout);
 
-    // Query for new records
-    query();
+    // Query for new records, the scheduler takes care of repeating the query
+    // with increasing intervals
+    QueryScheduler *scheduler = QueryScheduler::instance(server);
+    scheduler->addQuestion(this, name, A, this->cache);
+    scheduler->addQuestion(this, name, AAAA, this->cache);
 
     // Pull the existing records from the cache
     timer.setSingleShot(true);
     timer.start(0);
 }
 
+ResolverPrivate::~ResolverPrivate()
+{
+    if (dispatcher) {
+        dispatcher->unsubscribe(this);
+    }
+}
+
 QList<Record> ResolverPrivate::existing() const
 {
     QList<Record> records;
@@ -62,50 +77,64 @@ QList<Record> ResolverPrivate::existing() const
     return records;
 }
 
-void ResolverPrivate::query() const
+void ResolverPrivate::expire(const QHostAddress &address)
 {
-    Message message;
-
-    // Add a query for A and AAAA records
-    Query query;
-    query.setName(name);
-    query.setType(A);
-    message.addQuery(query);
-    query.setType(AAAA);
-    message.addQuery(query);
-
-    // Add existing (known) records to the query
-    const auto records = existing();
-    for (const Record &record : records) {
-        message.addRecord(record);
+    if (addresses.remove(address)) {
+        emit q->addressExpired(address);
     }
-
-    // Send the query
-    server->sendMessageToAll(message);
 }
 
-void ResolverPrivate::onMessageReceived(const Message &message)
+void ResolverPrivate::dispatchRecords(const Message &message, const QList<Record> &records)
 {
-    if (!message.isResponse()) {
-        return;
-    }
-    const auto records = message.records();
+    // Records with the cache-flush bit set replace all other addresses of the
+    // same type, which is what happens when a host changes its address
+    QSet<quint16> flushTypes;
+    QSet<QHostAddress> flushAddresses;
+
+    // Only A and AAAA records for the name are dispatched to the resolver
     for (const Record &record : records) {
-        if (record.name() == name && (record.type() == A || record.type() == AAAA)) {
-            cache->addRecord(record);
-            if (!addresses.contains(record.address())) {
-                emit q->resolved(record.address());
-                addresses.insert(record.address());
+        cache->addRecord(record, message.address());
+
+        // A TTL of 0 indicates that the address is no longer valid
+        if (record.ttl() == 0) {
+            expire(record.address());
+            continue;
+        }
+        if (record.flushCache()) {
+            flushTypes.insert(record.type());
+            flushAddresses.insert(record.address());
+        }
+        if (!addresses.contains(record.address())) {
+            emit q->resolved(record.address());
+            addresses.insert(record.address());
+        }
+    }
+
+    if (flushTypes.count()) {
+        const auto existingAddresses = addresses;
+        for (const QHostAddress &address : existingAddresses) {
+            quint16 type = address.protocol() == QAbstractSocket::IPv4Protocol ? A : AAAA;
+            if (flushTypes.contains(type) && !flushAddresses.contains(address)) {
+                expire(address);
             }
         }
     }
 }
 
+void ResolverPrivate::dispatchExpiredRecord(const Record &record)
+{
+    // Only A and AAAA records for the name are dispatched to the resolver
+    expire(record.address());
+}
+
 void ResolverPrivate::onTimeout()
 {
     const auto records = existing();
     for (const Record &record : records) {
-        emit q->resolved(record.address());
+        if (!addresses.contains(record.address())) {
+            emit q->resolved(record.address());
+            addresses.insert(record.address());
+        }
     }
 }
 
@@ -27,9 +27,12 @@
 
 #include <QHostAddress>
 #include <QObject>
+#include <QPointer>
 #include <QSet>
 #include <QTimer>
 
+#include "dispatcher_p.h"
+
 namespace QMdnsEngine
 {
 
@@ -39,18 +42,23 @@ class Message;
 class Record;
 class Resolver;
 
-class ResolverPrivate : public QObject
+class ResolverPrivate : public QObject, public Dispatcher::Subscriber
 {
     Q_OBJECT
 
 public:
 
     explicit ResolverPrivate(Resolver *resolver, AbstractServer *server, const QByteArray &name, Cache *cache);
+    virtual ~ResolverPrivate();
 
     QList<Record> existing() const;
-    void query() const;
+    void expire(const QHostAddress &address);
+
+    virtual void dispatchRecords(const Message &message, const QList<Record> &records);
+    virtual void dispatchExpiredRecord(const Record &record);
 
     AbstractServer *server;
+    QPointer<Dispatcher> dispatcher;
     QByteArray name;
     Cache *cache;
     QSet<QHostAddress> addresses;
@@ -58,7 +66,6 @@ public:
 
 private Q_SLOTS:
 
-    void onMessageReceived(const Message &message);
     void onTimeout();
 
 private:
@@ -37,6 +37,7 @@
 #include <qmdnsengine/mdns.h>
 #include <qmdnsengine/message.h>
 #include <qmdnsengine/server.h>
+#include <qmdnsengine/trace.h>
 
 #include "server_p.h"
 
@@ -44,6 +45,10 @@ using namespace QMdnsEngine;
 
 ServerPrivate::ServerPrivate(Server *server)
     : QObject(server),
+      packetsReceived(0),
+      packetsParsed(0),
+      packetsDropped(0),
+      bytesReceived(0),
       q(server)
 {
     connect(&timer, &QTimer::timeout, this, &ServerPrivate::onTimeout);
@@ -97,6 +102,10 @@ void ServerPrivate::onTimeout()
     bool ipv4Bound = bindSocket(ipv4Socket, QHostAddress::AnyIPv4);
     bool ipv6Bound = bindSocket(ipv6Socket, QHostAddress::AnyIPv6);
 
+    // Keep track of the interfaces and their addresses in order to indicate
+    // when they change
+    QSet<QString> newInterfaceAddresses;
+
     if (ipv4Bound || ipv6Bound) {
         const auto interfaces = QNetworkInterface::allInterfaces();
         for (const QNetworkInterface &interface : interfaces) {
@@ -107,15 +116,28 @@ void ServerPrivate::onTimeout()
                 if (ipv6Bound) {
                     ipv6Socket.joinMulticastGroup(MdnsIpv6Address, interface);
                 }
+                if (interface.flags() & QNetworkInterface::IsUp) {
+                    const auto entries = interface.addressEntries();
+                    for (const QNetworkAddressEntry &entry : entries) {
+                        newInterfaceAddresses.insert(interface.name() + "/" + entry.ip().toString());
+                    }
+                }
             }
         }
     }
 
+    if (newInterfaceAddresses != interfaceAddresses) {
+        interfaceAddresses = newInterfaceAddresses;
+        emit q->interfacesChanged();
+    }
+
     timer.start();
 }
 
 void ServerPrivate::onReadyRead()
 {
+    QMDNSENGINE_TRACE_SPAN("receive", "mdns");
+
     // Read the packet from the socket
     QUdpSocket *socket = qobject_cast<QUdpSocket*>(sender());
     QByteArray packet;
@@ -124,12 +146,23 @@ void ServerPrivate::onReadyRead()
     quint16 port;
     socket->readDatagram(packet.data(), packet.size(), &address, &port);
 
+    ++packetsReceived;
+    bytesReceived += packet.size();
+
     // Attempt to decode the packet
     Message message;
-    if (fromPacket(packet, message)) {
+    bool parsed;
+    {
+        QMDNSENGINE_TRACE_SPAN("parse", "mdns");
+        parsed = fromPacket(packet, message);
+    }
+    if (parsed) {
+        ++packetsParsed;
         message.setAddress(address);
         message.setPort(port);
         emit q->messageReceived(message);
+    } else {
+        ++packetsDropped;
     }
 }
 
@@ -139,6 +172,16 @@ Server::Server(QObject *parent)
 {
 }
 
+Server::Stats Server::stats() const
+{
+    Stats stats;
+    stats.packetsReceived = d->packetsReceived;
+    stats.packetsParsed = d->packetsParsed;
+    stats.packetsDropped = d->packetsDropped;
+    stats.bytesReceived = d->bytesReceived;
+    return stats;
+}
+
 void Server::sendMessage(const Message &message)
 {
     QByteArray packet;
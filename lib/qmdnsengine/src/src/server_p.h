@@ -26,6 +26,7 @@
 #define QMDNSENGINE_SERVER_P_H
 
 #include <QObject>
+#include <QSet>
 #include <QTimer>
 #include <QUdpSocket>
 
@@ -49,6 +50,12 @@ public:
     QTimer timer;
     QUdpSocket ipv4Socket;
     QUdpSocket ipv6Socket;
+    QSet<QString> interfaceAddresses;
+
+    quint64 packetsReceived;
+    quint64 packetsParsed;
+    quint64 packetsDropped;
+    quint64 bytesReceived;
 
 private Q_SLOTS:
 
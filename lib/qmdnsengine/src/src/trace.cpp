@@ -0,0 +1,148 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <atomic>
+#include <chrono>
+
+#include <QCoreApplication>
+#include <QIODevice>
+#include <QThread>
+
+#include <qmdnsengine/trace.h>
+
+namespace
+{
+
+// Must be a power of two so the slot can be found with a mask
+const quint64 Capacity = 1 << 16;
+
+struct Slot
+{
+    // Zero while empty or being written, otherwise the index of the span + 1
+    std::atomic<quint64> sequence;
+    const char *name;
+    const char *category;
+    qint64 start;
+    qint64 duration;
+    quintptr thread;
+};
+
+Slot buffer[Capacity];
+std::atomic<quint64> nextIndex(0);
+
+}
+
+using namespace QMdnsEngine;
+
+TraceSpan::TraceSpan(const char *name, const char *category)
+    : mName(name),
+      mCategory(category),
+      mStart(traceTimestamp())
+{
+}
+
+TraceSpan::~TraceSpan()
+{
+    recordTraceSpan(mName, mCategory, mStart, traceTimestamp() - mStart);
+}
+
+qint64 QMdnsEngine::traceTimestamp()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+void QMdnsEngine::recordTraceSpan(const char *name, const char *category, qint64 start, qint64 duration)
+{
+    // Claim a slot, then mark it as busy while the fields are written so that
+    // readers can detect a span being overwritten
+    quint64 index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = buffer[index & (Capacity - 1)];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name = name;
+    slot.category = category;
+    slot.start = start;
+    slot.duration = duration;
+    slot.thread = reinterpret_cast<quintptr>(QThread::currentThreadId());
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+bool QMdnsEngine::writeChromeTrace(QIODevice *device)
+{
+    qint64 pid = QCoreApplication::applicationPid();
+    quint64 end = nextIndex.load(std::memory_order_acquire);
+    quint64 begin = end > Capacity ? end - Capacity : 0;
+
+    QByteArray output = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+
+    // Walk from the oldest to the newest span, copying each slot and only
+    // using the copy if its sequence did not change in the meantime
+    for (quint64 index = begin; index < end; ++index) {
+        Slot &slot = buffer[index & (Capacity - 1)];
+        quint64 sequence = slot.sequence.load(std::memory_order_acquire);
+        const char *name = slot.name;
+        const char *category = slot.category;
+        qint64 start = slot.start;
+        qint64 duration = slot.duration;
+        quintptr thread = slot.thread;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence != index + 1 || slot.sequence.load(std::memory_order_relaxed) != sequence) {
+            continue;
+        }
+
+        if (!first) {
+            output.append(',');
+        }
+        first = false;
+
+        // Timestamps in the Trace Event Format are in microseconds
+        output.append("{\"ph\":\"X\",\"name\":\"");
+        output.append(name);
+        output.append("\",\"cat\":\"");
+        output.append(category);
+        output.append("\",\"ts\":");
+        output.append(QByteArray::number(start / 1000.0, 'f', 3));
+        output.append(",\"dur\":");
+        output.append(QByteArray::number(duration / 1000.0, 'f', 3));
+        output.append(",\"pid\":");
+        output.append(QByteArray::number(pid));
+        output.append(",\"tid\":");
+        output.append(QByteArray::number(static_cast<quint64>(thread)));
+        output.append('}');
+    }
+    output.append("]}\n");
+
+    return device->write(output) == output.size();
+}
+
+void QMdnsEngine::clearTrace()
+{
+    // Mark all slots as empty, the index keeps increasing
+    for (quint64 index = 0; index < Capacity; ++index) {
+        buffer[index].sequence.store(0, std::memory_order_relaxed);
+    }
+}
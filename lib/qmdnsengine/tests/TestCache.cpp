@@ -0,0 +1,167 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <QHostAddress>
+#include <QObject>
+#include <QSignalSpy>
+#include <QTest>
+
+#include <qmdnsengine/cache.h>
+#include <qmdnsengine/dns.h>
+#include <qmdnsengine/record.h>
+
+Q_DECLARE_METATYPE(QMdnsEngine::Record)
+
+static QMdnsEngine::Record txtRecord(const QByteArray &name)
+{
+    QMdnsEngine::Record record;
+    record.setName(name);
+    record.setType(QMdnsEngine::TXT);
+    record.setTtl(120);
+    return record;
+}
+
+class TestCache : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void initTestCase();
+    void testMaximumEntries();
+    void testLeastRecentlyUsed();
+    void testWatchedTypes();
+    void testAddressEviction();
+    void testMaximumEntriesPerSource();
+    void testLookupStats();
+};
+
+void TestCache::initTestCase()
+{
+    qRegisterMetaType<QMdnsEngine::Record>();
+}
+
+void TestCache::testMaximumEntries()
+{
+    QMdnsEngine::Cache cache;
+    cache.setMaximumEntries(2);
+    QSignalSpy recordExpiredSpy(&cache, &QMdnsEngine::Cache::recordExpired);
+
+    cache.addRecord(txtRecord("a._http._tcp.local."));
+    cache.addRecord(txtRecord("b._http._tcp.local."));
+    cache.addRecord(txtRecord("c._http._tcp.local."));
+
+    // The oldest record makes room for the new one
+    QCOMPARE(cache.stats().entries, 2);
+    QCOMPARE(cache.stats().evictions, quint64(1));
+    QCOMPARE(recordExpiredSpy.count(), 1);
+    QCOMPARE(recordExpiredSpy.at(0).at(0).value<QMdnsEngine::Record>().name(), QByteArray("a._http._tcp.local."));
+}
+
+void TestCache::testLeastRecentlyUsed()
+{
+    QMdnsEngine::Cache cache;
+    cache.setMaximumEntries(2);
+    QSignalSpy recordExpiredSpy(&cache, &QMdnsEngine::Cache::recordExpired);
+
+    cache.addRecord(txtRecord("a._http._tcp.local."));
+    cache.addRecord(txtRecord("b._http._tcp.local."));
+
+    // Looking up the oldest record keeps it in the cache
+    QMdnsEngine::Record record;
+    QVERIFY(cache.lookupRecord("a._http._tcp.local.", QMdnsEngine::TXT, record));
+    cache.addRecord(txtRecord("c._http._tcp.local."));
+
+    QCOMPARE(recordExpiredSpy.count(), 1);
+    QCOMPARE(recordExpiredSpy.at(0).at(0).value<QMdnsEngine::Record>().name(), QByteArray("b._http._tcp.local."));
+    QVERIFY(cache.lookupRecord("a._http._tcp.local.", QMdnsEngine::TXT, record));
+}
+
+void TestCache::testWatchedTypes()
+{
+    QMdnsEngine::Cache cache;
+    cache.addWatchedType("_http._tcp.local.");
+    QSignalSpy recordExpiredSpy(&cache, &QMdnsEngine::Cache::recordExpired);
+
+    cache.addRecord(txtRecord("a._http._tcp.local."));
+    cache.addRecord(txtRecord("b._ipp._tcp.local."));
+    cache.setMaximumEntries(1);
+
+    // The more recently used record is evicted since nobody watches its type
+    QCOMPARE(recordExpiredSpy.count(), 1);
+    QCOMPARE(recordExpiredSpy.at(0).at(0).value<QMdnsEngine::Record>().name(), QByteArray("b._ipp._tcp.local."));
+}
+
+void TestCache::testAddressEviction()
+{
+    QMdnsEngine::Cache cache;
+    QSignalSpy shouldQuerySpy(&cache, &QMdnsEngine::Cache::shouldQuery);
+    QSignalSpy recordExpiredSpy(&cache, &QMdnsEngine::Cache::recordExpired);
+
+    QMdnsEngine::Record record;
+    record.setName("host.local.");
+    record.setType(QMdnsEngine::A);
+    record.setTtl(120);
+    record.setAddress(QHostAddress("192.168.1.1"));
+    cache.addRecord(record);
+    cache.setMaximumEntries(0);
+
+    // An evicted address is still valid, so it is queried again instead of expired
+    QCOMPARE(cache.stats().entries, 0);
+    QCOMPARE(shouldQuerySpy.count(), 1);
+    QCOMPARE(recordExpiredSpy.count(), 0);
+}
+
+void TestCache::testMaximumEntriesPerSource()
+{
+    QMdnsEngine::Cache cache;
+    cache.setMaximumEntriesPerSource(1);
+
+    QHostAddress source("192.168.1.1");
+    cache.addRecord(txtRecord("a._http._tcp.local."), source);
+    cache.addRecord(txtRecord("b._http._tcp.local."), source);
+    cache.addRecord(txtRecord("c._http._tcp.local."), QHostAddress("192.168.1.2"));
+
+    // Only the second record of the first source is refused
+    QCOMPARE(cache.stats().entries, 2);
+    QCOMPARE(cache.stats().rejections, quint64(1));
+}
+
+void TestCache::testLookupStats()
+{
+    QMdnsEngine::Cache cache;
+    cache.addRecord(txtRecord("a._http._tcp.local."));
+
+    QList<QMdnsEngine::Record> records;
+    QVERIFY(cache.lookupRecords("a._http._tcp.local.", QMdnsEngine::ANY, records));
+    QVERIFY(!cache.lookupRecords("b._http._tcp.local.", QMdnsEngine::ANY, records));
+
+    QCOMPARE(records.count(), 1);
+    QCOMPARE(cache.stats().hits, quint64(1));
+    QCOMPARE(cache.stats().misses, quint64(1));
+}
+
+QTEST_MAIN(TestCache)
+#include "TestCache.moc"
@@ -0,0 +1,94 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <QObject>
+#include <QTest>
+
+#include <qmdnsengine/dns.h>
+#include <qmdnsengine/message.h>
+#include <qmdnsengine/query.h>
+#include <qmdnsengine/record.h>
+
+static QMdnsEngine::Message knownAnswerQuery(int answers, const QByteArray &attribute)
+{
+    QMdnsEngine::Query query;
+    query.setName("_http._tcp.local.");
+    query.setType(QMdnsEngine::PTR);
+
+    QMdnsEngine::Message message;
+    message.addQuery(query);
+    for (int i = 0; i < answers; ++i) {
+        QMdnsEngine::Record record;
+        record.setName("_http._tcp.local.");
+        record.setType(QMdnsEngine::PTR);
+        record.setTtl(120);
+        record.setTarget("service " + QByteArray::number(i) + attribute + "._http._tcp.local.");
+        message.addRecord(record);
+    }
+    return message;
+}
+
+class TestDns : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void testSplitKnownAnswers();
+    void testSplitOversizedAnswer();
+};
+
+void TestDns::testSplitKnownAnswers()
+{
+    const int maximumSize = 512;
+    QList<QMdnsEngine::Message> messages = QMdnsEngine::splitKnownAnswers(knownAnswerQuery(100, QByteArray()), maximumSize);
+    QVERIFY(messages.count() > 1);
+
+    // The queries only go into the first packet and all packets but the last
+    // one announce that more known answers follow
+    int records = 0;
+    for (int i = 0; i < messages.count(); ++i) {
+        QByteArray packet;
+        QMdnsEngine::toPacket(messages.at(i), packet);
+        QVERIFY(packet.size() <= maximumSize);
+        QCOMPARE(messages.at(i).queries().count(), i == 0 ? 1 : 0);
+        QCOMPARE(messages.at(i).isTruncated(), i < messages.count() - 1);
+        records += messages.at(i).records().count();
+    }
+    QCOMPARE(records, 100);
+}
+
+void TestDns::testSplitOversizedAnswer()
+{
+    // Answers that don't fit in any packet are still sent, each on its own
+    QList<QMdnsEngine::Message> messages = QMdnsEngine::splitKnownAnswers(knownAnswerQuery(2, QByteArray(40, 'x')), 64);
+    QCOMPARE(messages.count(), 3);
+    QCOMPARE(messages.at(0).records().count(), 0);
+    QCOMPARE(messages.at(1).records().count(), 1);
+    QCOMPARE(messages.at(2).records().count(), 1);
+}
+
+QTEST_MAIN(TestDns)
+#include "TestDns.moc"
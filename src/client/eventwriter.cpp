@@ -0,0 +1,122 @@
+#include "eventwriter.h"
+#include <QDateTime>
+#include <QDataStream>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <cstdio>
+
+// Events are written once this much is buffered, or once the buffer is this old
+static const int FlushSize = 64 * 1024;
+static const int FlushInterval = 100;
+
+enum EventType : quint8
+{
+	ADD_OR_UPDATE_EVENT = 1,
+	REMOVE_EVENT = 2
+};
+
+EventWriter::EventWriter(ServiceRepository &serviceRepository, const QString &fileName, Format format) :
+	QObject(),
+	serviceRepository(serviceRepository),
+	format(format),
+	flushTimer(this)
+{
+	// Observe the repository
+	serviceRepository.addObserver(this);
+
+	// Register event handlers
+	connect(&flushTimer, &QTimer::timeout, this, &EventWriter::flush);
+	flushTimer.setSingleShot(true);
+	flushTimer.setInterval(FlushInterval);
+
+	// Open the output unbuffered, the events are buffered here already
+	if(fileName.isEmpty() || fileName == "-") {
+		file.open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered);
+	} else {
+		file.setFileName(fileName);
+		file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered);
+	}
+
+	buffer.reserve(FlushSize * 2);
+}
+
+EventWriter::~EventWriter()
+{
+	// Write the remaining events
+	flush();
+}
+
+bool EventWriter::isOpen() const
+{
+	return file.isOpen();
+}
+
+void EventWriter::flush()
+{
+	flushTimer.stop();
+
+	if(!buffer.isEmpty()) {
+		file.write(buffer);
+		buffer.clear();
+	}
+}
+
+void EventWriter::bufferWritten()
+{
+	if(buffer.size() >= FlushSize) {
+		flush();
+	} else if(!flushTimer.isActive()) {
+		flushTimer.start();
+	}
+}
+
+void EventWriter::onAddOrUpdateService(const QMdnsEngine::Service &service)
+{
+	// Differentiate between service types of the same service
+	QByteArray fullName = serviceRepository.getServiceFullName(service);
+
+	if(format == BINARY) {
+		writeAddOrUpdateBinary(fullName, service);
+	} else {
+		writeAddOrUpdateJson(service);
+	}
+
+	bufferWritten();
+}
+
+void EventWriter::onRemoveService(const QString &fullName)
+{
+	qint64 time = QDateTime::currentMSecsSinceEpoch();
+
+	if(format == BINARY) {
+		QDataStream stream(&buffer, QIODevice::WriteOnly | QIODevice::Append);
+		stream.setVersion(QDataStream::Qt_5_0);
+		stream << quint8(REMOVE_EVENT) << time << fullName.toUtf8();
+	} else {
+		QJsonObject jsonEvent;
+		jsonEvent["time"] = time;
+		jsonEvent["event"] = "remove";
+		jsonEvent["fullname"] = fullName;
+		buffer += QJsonDocument(jsonEvent).toJson(QJsonDocument::Compact);
+		buffer += '\n';
+	}
+
+	bufferWritten();
+}
+
+void EventWriter::writeAddOrUpdateJson(const QMdnsEngine::Service &service)
+{
+	// Splice in the same encoding of the service the server sends, which the repository reuses until it changes
+	buffer += "{\"time\":" + QByteArray::number(QDateTime::currentMSecsSinceEpoch()) + ",\"event\":\"add_or_update\",\"service\":";
+	buffer += serviceRepository.getJsonService(service);
+	buffer += "}\n";
+}
+
+void EventWriter::writeAddOrUpdateBinary(const QByteArray &fullName, const QMdnsEngine::Service &service)
+{
+	QDataStream stream(&buffer, QIODevice::WriteOnly | QIODevice::Append);
+	stream.setVersion(QDataStream::Qt_5_0);
+	stream << quint8(ADD_OR_UPDATE_EVENT) << QDateTime::currentMSecsSinceEpoch() << fullName;
+	stream << service.name() << service.type() << service.hostname() << service.port();
+	stream << service.attributes() << serviceRepository.getAddresses().value(fullName);
+}
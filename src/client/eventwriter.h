@@ -0,0 +1,55 @@
+#ifndef EVENTWRITER_H
+#define EVENTWRITER_H
+
+#include <QFile>
+#include <QTimer>
+#include "../common/servicerepository.h"
+
+// Writes every change in the repository as an event to stdout or a file, events are buffered and written in blocks
+//
+// The NDJSON format writes one object per line:
+//   {"time":<ms since epoch>,"event":"add_or_update","service":{<same fields as the server sends>}}
+//   {"time":<ms since epoch>,"event":"remove","fullname":"<full name>"}
+//
+// The binary format writes QDataStream records (version Qt_5_0, big endian), each starting with a quint8 event type and a
+// qint64 time in ms since epoch, followed by the full name as QByteArray. Add or update events (1) then contain the
+// name, type and hostname as QByteArray, the port as quint16, the attributes as QMap<QByteArray, QByteArray> and the
+// addresses as QList<QString>. Remove events (2) contain nothing else.
+class EventWriter : public QObject, public Observer
+{
+	Q_OBJECT
+
+	public:
+		enum Format
+		{
+			NDJSON,
+			BINARY
+		};
+
+	private:
+		ServiceRepository &serviceRepository;
+		Format format;
+
+		QFile file;
+		QByteArray buffer;
+		QTimer flushTimer;
+
+		void writeAddOrUpdateJson(const QMdnsEngine::Service &service);
+		void writeAddOrUpdateBinary(const QByteArray &fullName, const QMdnsEngine::Service &service);
+		void bufferWritten();
+
+	public:
+		// An empty file name or '-' writes to stdout
+		EventWriter(ServiceRepository &serviceRepository, const QString &fileName, Format format);
+		~EventWriter();
+
+		bool isOpen() const;
+
+		void onAddOrUpdateService(const QMdnsEngine::Service &service) override;
+		void onRemoveService(const QString &fullName) override;
+
+	public slots:
+		void flush();
+};
+
+#endif
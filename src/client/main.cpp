@@ -1,16 +1,31 @@
 #include <QApplication>
 #include <QCommandLineParser>
+#include <QDebug>
+#include <cstring>
+#include <memory>
 #include "../common/servicerepository.h"
-#include "clientsocket.h"
+#include "../common/serviceindex.h"
+#include "../common/signalhandler.h"
+#include "../common/clientsocket.h"
+#include "eventwriter.h"
+#include "repositorycache.h"
 #include "mainwindow.h"
 
 int main(int argc, char *argv[])
 {
-	QApplication app(argc, argv);
-	app.setApplicationName("Client");
-	app.setApplicationVersion("1.0.0");
-	app.setOrganizationDomain("example.com");
-	app.setOrganizationName("Example");
+	// The headless mode doesn't use any widgets and runs without a display, so decide before creating the application
+	bool headless = false;
+	for(int i = 1; i < argc; i++) {
+		if(std::strcmp(argv[i], "--headless") == 0) {
+			headless = true;
+		}
+	}
+
+	std::unique_ptr<QCoreApplication> app(headless ? new QCoreApplication(argc, argv) : new QApplication(argc, argv));
+	app->setApplicationName("Client");
+	app->setApplicationVersion("1.0.0");
+	app->setOrganizationDomain("example.com");
+	app->setOrganizationName("Example");
 
 	// Setup command line options
 	QCommandLineParser parser;
@@ -19,25 +34,78 @@ int main(int argc, char *argv[])
 	parser.addVersionOption();
 	parser.addOption({{"u", "url"}, "The URL to connect to (default = ws://localhost:1234).", "url", "ws://localhost:1234"});
 	parser.addOption({{"m", "max-retries"}, "The maximum amount of reconnection attempts (default = unlimited = -1).", "max", "-1"});
-	parser.addOption({{"r", "retry-interval"}, "The time to wait in ms before attempting a reconnect (default = 5000).", "interval", "5000"});
-	parser.addOption({{"f", "refresh-interval"}, "The time to wait in ms before requesting a data refresh (default = unlimited = -1).", "interval", "-1"});
+	parser.addOption({{"r", "retry-interval"}, "The time to wait in ms before the first reconnect attempt, the actual time is random up to this interval and the interval doubles with every further attempt (default = 5000).", "interval", "5000"});
+	parser.addOption({"max-retry-interval", "The maximum time to wait in ms before attempting a reconnect, doubling the retry interval after each attempt (default = 60000).", "interval", "60000"});
+	parser.addOption({{"f", "refresh-interval"}, "The time to wait in ms before requesting a data refresh, not needed as the server announces its revision (default = unlimited = -1).", "interval", "-1"});
+	parser.addOption({"ping-interval", "The time in ms between pinging the server, reconnecting when it stops responding (default = 30000, never = -1).", "interval", "30000"});
+	parser.addOption({{"c", "compression"}, "Ask the server to compress large messages."});
+	parser.addOption({{"s", "stream-snapshot"}, "Ask the server to send the list of services in chunks, displaying them as they arrive."});
+	parser.addOption({"cache-file", "The file to store the services in, showing them immediately on startup and only requesting the changes since (default = none).", "file", ""});
+	parser.addOption({"headless", "Run without GUI, writing every change as an event instead."});
+	parser.addOption({{"o", "output"}, "The file to append events to in headless mode (default = stdout = -).", "file", "-"});
+	parser.addOption({"format", "The format of events in headless mode, ndjson or binary (default = ndjson).", "format", "ndjson"});
 	parser.addOption({"verbose", "Displays debug information."});
-	parser.process(app);
+	parser.process(*app);
 
 	// Parse command line options
 	QString url = parser.value("u");
 	int maxRetries = parser.value("m").toInt();
 	int retryInterval = parser.value("r").toInt();
+	int maxRetryInterval = parser.value("max-retry-interval").toInt();
 	int refreshInterval = parser.value("f").toInt();
+	int pingInterval = parser.value("ping-interval").toInt();
+	bool compression = parser.isSet("c");
+	bool streamSnapshot = parser.isSet("s");
+	QString cacheFile = parser.value("cache-file");
+	QString output = parser.value("o");
+	QString format = parser.value("format");
 	bool verbose = parser.isSet("verbose");
 
+	if(format != "ndjson" && format != "binary") {
+		qCritical() << "Unsupported format" << format;
+		return 1;
+	}
+
+	// Quit on SIGINT and SIGTERM, so the events and the cache are flushed
+	SignalHandler signalHandler;
+
 	// Create components
 	ServiceRepository serviceRepository;
-	ClientSocket clientSocket(serviceRepository, url, maxRetries, retryInterval, refreshInterval, verbose);
+
+	// Restore the services of the previous run
+	std::unique_ptr<RepositoryCache> repositoryCache;
+	if(!cacheFile.isEmpty()) {
+		repositoryCache.reset(new RepositoryCache(serviceRepository, cacheFile));
+		if(repositoryCache->load() && verbose) qDebug() << "Restored" << serviceRepository.getServices().size() << "services at revision" << serviceRepository.getRevision();
+	}
+
+	// Write events instead of showing a GUI, without keeping a search index
+	if(headless) {
+		EventWriter eventWriter(serviceRepository, output, format == "binary" ? EventWriter::BINARY : EventWriter::NDJSON);
+		if(!eventWriter.isOpen()) {
+			qCritical() << "Unable to open" << output;
+			return 1;
+		}
+
+		ClientSocket clientSocket(serviceRepository, nullptr, url, maxRetries, retryInterval, maxRetryInterval, refreshInterval, pingInterval, compression, streamSnapshot, verbose);
+		if(repositoryCache) {
+			QObject::connect(&clientSocket, &ClientSocket::changed, repositoryCache.get(), &RepositoryCache::scheduleSave);
+			QObject::connect(&clientSocket, &ClientSocket::snapshotStarted, repositoryCache.get(), &RepositoryCache::cancelSave);
+		}
+
+		return app->exec();
+	}
+
+	ServiceIndex serviceIndex;
+	ClientSocket clientSocket(serviceRepository, &serviceIndex, url, maxRetries, retryInterval, maxRetryInterval, refreshInterval, pingInterval, compression, streamSnapshot, verbose);
+	if(repositoryCache) {
+		QObject::connect(&clientSocket, &ClientSocket::changed, repositoryCache.get(), &RepositoryCache::scheduleSave);
+		QObject::connect(&clientSocket, &ClientSocket::snapshotStarted, repositoryCache.get(), &RepositoryCache::cancelSave);
+	}
 
 	// Create and show GUI
-	MainWindow mainWindow(serviceRepository, clientSocket);
+	MainWindow mainWindow(serviceRepository, serviceIndex, clientSocket);
 	mainWindow.show();
 
-	return app.exec();
+	return app->exec();
 }
\ No newline at end of file
@@ -2,14 +2,17 @@
 #include "ui_mainwindow.h"
 #include <QScreen>
 
-MainWindow::MainWindow(ServiceRepository &serviceRepository, ClientSocket &clientSocket) :
+MainWindow::MainWindow(ServiceRepository &serviceRepository, ServiceIndex &serviceIndex, ClientSocket &clientSocket) :
 	QMainWindow(),
 	serviceRepository(serviceRepository),
 	clientSocket(clientSocket),
-	ui(new Ui::MainWindow)
+	ui(new Ui::MainWindow),
+	serviceModel(serviceRepository, this),
+	filteredServiceModel(serviceIndex, this),
+	extrasDirty(false)
 {
 	// Observe the repository
-	serviceRepository.setObserver(this);
+	serviceRepository.addObserver(this);
 	
 	// Configure initial UI according to the generated UI header file
 	ui->setupUi(this);
@@ -18,9 +21,25 @@ MainWindow::MainWindow(ServiceRepository &serviceRepository, ClientSocket &clien
 	setWindowTitle("Client");
 	move(QGuiApplication::primaryScreen()->geometry().center() - frameGeometry().center());
 
+	// Display the services matching the filter sorted by name, the view only lays out the visible rows
+	filteredServiceModel.setSourceModel(&serviceModel);
+	filteredServiceModel.setDynamicSortFilter(true);
+	filteredServiceModel.sort(0);
+	ui->services->setModel(&filteredServiceModel);
+
 	// Register event handlers
-	connect(ui->services, &QListWidget::currentTextChanged, this, &MainWindow::onSelectionChanged);
+	connect(ui->services->selectionModel(), &QItemSelectionModel::currentChanged, this, &MainWindow::onSelectionChanged);
+	connect(&filteredServiceModel, &QAbstractItemModel::rowsInserted, this, &MainWindow::onServicesInserted);
+	connect(&serviceModel, &ServiceModel::flushed, this, &MainWindow::onServicesFlushed);
 	connect(ui->refreshButton, &QToolButton::clicked, this, &MainWindow::onRefreshTriggered);
+	connect(ui->filter, &QLineEdit::textChanged, this, &MainWindow::onFilterChanged);
+
+	// Show the services that are already known immediately, for example restored from the cache
+	QMap<QByteArray, QMdnsEngine::Service> &services = serviceRepository.getServices();
+	for(auto it = services.begin(); it != services.end(); it++) {
+		serviceModel.addService(it.key());
+	}
+	serviceModel.flush();
 }
 
 MainWindow::~MainWindow()
@@ -29,59 +48,92 @@ MainWindow::~MainWindow()
 	delete ui;
 }
 
-void MainWindow::onSelectionChanged(const QString &fullName)
+void MainWindow::onSelectionChanged(const QModelIndex &current)
 {
 	// Display extras of the current selected service
-	showExtras(fullName);
+	showExtras(current.data().toString());
+}
+
+void MainWindow::onServicesInserted()
+{
+	// Select the first item when the list was empty
+	if(!ui->services->currentIndex().isValid()) {
+		ui->services->setCurrentIndex(filteredServiceModel.index(0, 0));
+	}
+}
+
+void MainWindow::onServicesFlushed()
+{
+	// Rebuild the extras once per frame at most
+	if(extrasDirty) {
+		showExtras(currentService());
+	}
+}
+
+void MainWindow::onFilterChanged(const QString &query)
+{
+	// Only display the services matching the query
+	filteredServiceModel.setQuery(query);
+
+	// Select the first matching item when the current one was filtered out
+	if(!ui->services->currentIndex().isValid()) {
+		ui->services->setCurrentIndex(filteredServiceModel.index(0, 0));
+	}
+}
+
+QString MainWindow::currentService() const
+{
+	return ui->services->currentIndex().data().toString();
 }
 
 void MainWindow::onRefreshTriggered()
 {
-	// Remove all extras and services first
-	ui->information->clearContents();
-	ui->attributes->clearContents();
-	ui->addresses->clear();
-	ui->services->clear();
-	
-	// Manually ask the server for a refresh of the services
+	// Manually ask the server for a refresh of the services, only the differences are applied to the list
 	clientSocket.refreshServices();
 }
 
 void MainWindow::showExtras(const QString &fullName)
 {
+	extrasDirty = false;
+
 	// Remove all extras first
 	ui->information->clearContents();
 	ui->attributes->clearContents();
 	ui->addresses->clear();
 
+	// The list is updated with the next frame, so the selected service may already be removed from the repository.
+	// Only look it up, so no empty service is inserted into the repository.
+	auto found = serviceRepository.getServices().constFind(fullName.toUtf8());
+	if(found == serviceRepository.getServices().constEnd()) {
+		return;
+	}
+
 	// Display extras
-	if(!fullName.isEmpty()) {
-		QMdnsEngine::Service &service = serviceRepository.getServices()[fullName.toUtf8()];
-
-		ui->information->setItem(0, 0, new QTableWidgetItem("Name"));
-		ui->information->setItem(0, 1, new QTableWidgetItem(QString(service.name())));
-		ui->information->setItem(1, 0, new QTableWidgetItem("Hostname"));
-		ui->information->setItem(1, 1, new QTableWidgetItem(QString(service.hostname())));
-		ui->information->setItem(2, 0, new QTableWidgetItem("Port"));
-		ui->information->setItem(2, 1, new QTableWidgetItem(QString::number(service.port())));
-		ui->information->setItem(3, 0, new QTableWidgetItem("Type"));
-		ui->information->setItem(3, 1, new QTableWidgetItem(QString(service.type())));
-		ui->information->setItem(4, 0, new QTableWidgetItem("Fullname"));
-		ui->information->setItem(4, 1, new QTableWidgetItem(fullName));
-		ui->information->resizeColumnToContents(0);
-
-		int row = 0;
-		QMap<QByteArray, QByteArray> attributes = service.attributes();
-		ui->attributes->setRowCount(attributes.size());
-		for(auto it = attributes.begin(); it != attributes.end(); it++, row++) {
-			ui->attributes->setItem(row, 0, new QTableWidgetItem(QString(it.key())));
-			ui->attributes->setItem(row, 1, new QTableWidgetItem(QString(it.value())));
-		}
-		ui->information->resizeColumnToContents(0);
+	const QMdnsEngine::Service &service = *found;
 
-		for(const auto &address : serviceRepository.getAddresses()[fullName.toUtf8()]) {
-			ui->addresses->addItem(address);
-		}
+	ui->information->setItem(0, 0, new QTableWidgetItem("Name"));
+	ui->information->setItem(0, 1, new QTableWidgetItem(QString(service.name())));
+	ui->information->setItem(1, 0, new QTableWidgetItem("Hostname"));
+	ui->information->setItem(1, 1, new QTableWidgetItem(QString(service.hostname())));
+	ui->information->setItem(2, 0, new QTableWidgetItem("Port"));
+	ui->information->setItem(2, 1, new QTableWidgetItem(QString::number(service.port())));
+	ui->information->setItem(3, 0, new QTableWidgetItem("Type"));
+	ui->information->setItem(3, 1, new QTableWidgetItem(QString(service.type())));
+	ui->information->setItem(4, 0, new QTableWidgetItem("Fullname"));
+	ui->information->setItem(4, 1, new QTableWidgetItem(fullName));
+	ui->information->resizeColumnToContents(0);
+
+	int row = 0;
+	QMap<QByteArray, QByteArray> attributes = service.attributes();
+	ui->attributes->setRowCount(attributes.size());
+	for(auto it = attributes.begin(); it != attributes.end(); it++, row++) {
+		ui->attributes->setItem(row, 0, new QTableWidgetItem(QString(it.key())));
+		ui->attributes->setItem(row, 1, new QTableWidgetItem(QString(it.value())));
+	}
+	ui->information->resizeColumnToContents(0);
+
+	for(const auto &address : serviceRepository.getAddresses().value(fullName.toUtf8())) {
+		ui->addresses->addItem(address);
 	}
 }
 
@@ -90,23 +142,26 @@ void MainWindow::onAddOrUpdateService(const QMdnsEngine::Service &service)
 	// Differentiate between service types of the same service
 	QByteArray fullName = serviceRepository.getServiceFullName(service);
 
+	// Update whether the service matches the filter before the list reports the change
+	filteredServiceModel.updateService(fullName);
+
 	// Add the service to the list of services
-	if(ui->services->findItems(fullName, Qt::MatchExactly).empty()) {
-		ui->services->addItem(fullName);
+	if(!serviceModel.contains(fullName)) {
+		serviceModel.addService(fullName);
+	}
+	else {
+		serviceModel.updateService(fullName);
 
-		// Select the first item when the list was empty
-		if(ui->services->count() == 1) {
-			ui->services->setCurrentRow(0);
+		// Update the service extras with the next frame when the updated service is the current selected service
+		if(currentService() == fullName) {
+			extrasDirty = true;
 		}
 	}
-	// Update the service extras when the updated service is the current selected service
-	else if(ui->services->currentItem()->text() == fullName) {
-		showExtras(fullName);
-	}
 }
 
 void MainWindow::onRemoveService(const QString &fullName)
 {
 	// Remove the service from the list of services
-	delete ui->services->findItems(fullName, Qt::MatchExactly).first();
+	serviceModel.removeService(fullName.toUtf8());
+	filteredServiceModel.removeService(fullName.toUtf8());
 }
\ No newline at end of file
@@ -2,8 +2,10 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include "clientsocket.h"
+#include "../common/clientsocket.h"
 #include "../common/servicerepository.h"
+#include "servicemodel.h"
+#include "servicefiltermodel.h"
 
 namespace Ui {
 	class MainWindow;
@@ -17,18 +19,25 @@ class MainWindow : public QMainWindow, public Observer
 		ServiceRepository &serviceRepository;
 		ClientSocket &clientSocket;
 		Ui::MainWindow *ui;
+		ServiceModel serviceModel;
+		ServiceFilterModel filteredServiceModel;
+		bool extrasDirty;
 
 		void showExtras(const QString &fullName);
+		QString currentService() const;
 
 	public:
-		MainWindow(ServiceRepository &serviceRepository, ClientSocket &clientSocket);
+		MainWindow(ServiceRepository &serviceRepository, ServiceIndex &serviceIndex, ClientSocket &clientSocket);
 		~MainWindow();
 		
 		void onAddOrUpdateService(const QMdnsEngine::Service &service) override;
 		void onRemoveService(const QString &fullName) override;
 
 	private slots:
-		void onSelectionChanged(const QString &fullName);
+		void onSelectionChanged(const QModelIndex &current);
+		void onServicesInserted();
+		void onServicesFlushed();
+		void onFilterChanged(const QString &query);
 		void onRefreshTriggered();
 };
 
@@ -0,0 +1,140 @@
+#include "repositorycache.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+
+static const quint32 Magic = 0x42575343;
+static const quint32 Version = 2;
+
+// Changes arriving in bursts are stored at most this often
+static const int SaveInterval = 2000;
+
+RepositoryCache::RepositoryCache(ServiceRepository &serviceRepository, const QString &fileName) :
+	QObject(),
+	serviceRepository(serviceRepository),
+	fileName(fileName),
+	saveTimer(this)
+{
+	// Register event handlers
+	connect(&saveTimer, &QTimer::timeout, this, &RepositoryCache::save);
+
+	saveTimer.setSingleShot(true);
+	saveTimer.setInterval(SaveInterval);
+}
+
+RepositoryCache::~RepositoryCache()
+{
+	// Store the latest changes
+	if(saveTimer.isActive()) {
+		save();
+	}
+}
+
+bool RepositoryCache::load()
+{
+	QFile file(fileName);
+	if(!file.open(QIODevice::ReadOnly) || file.size() == 0) {
+		return false;
+	}
+
+	// Map the file instead of reading it, the services are copied out of it while parsing
+	uchar *data = file.map(0, file.size());
+	if(!data) {
+		return false;
+	}
+	QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char *>(data), file.size());
+
+	QDataStream stream(bytes);
+	stream.setVersion(QDataStream::Qt_5_0);
+
+	quint32 magic;
+	quint32 version;
+	QByteArray epoch;
+	quint64 revision;
+	quint32 count;
+	stream >> magic >> version >> epoch >> revision >> count;
+
+	QMap<QByteArray, QMdnsEngine::Service> services;
+	QMap<QByteArray, QList<QString>> addresses;
+	QMap<QByteArray, QList<QString>> paths;
+	if(magic == Magic && version == Version) {
+		for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++) {
+			QByteArray fullName;
+			QByteArray name;
+			QByteArray type;
+			QByteArray hostname;
+			quint16 port;
+			QMap<QByteArray, QByteArray> attributes;
+			QList<QString> serviceAddresses;
+			QList<QString> path;
+			stream >> fullName >> name >> type >> hostname >> port >> attributes >> serviceAddresses >> path;
+
+			QMdnsEngine::Service service;
+			service.setName(name);
+			service.setType(type);
+			service.setHostname(hostname);
+			service.setPort(port);
+			service.setAttributes(attributes);
+			services.insert(fullName, service);
+			addresses.insert(fullName, serviceAddresses);
+			if(!path.isEmpty()) {
+				paths.insert(fullName, path);
+			}
+		}
+	}
+
+	bool valid = magic == Magic && version == Version && stream.status() == QDataStream::Ok;
+	file.unmap(data);
+
+	// Only use a completely valid cache
+	if(!valid) {
+		return false;
+	}
+
+	serviceRepository.getServices() = services;
+	serviceRepository.getAddresses() = addresses;
+	serviceRepository.getPaths() = paths;
+	serviceRepository.setEpoch(epoch);
+	serviceRepository.setRevision(revision);
+
+	return true;
+}
+
+void RepositoryCache::scheduleSave()
+{
+	if(!saveTimer.isActive()) {
+		saveTimer.start();
+	}
+}
+
+void RepositoryCache::cancelSave()
+{
+	// A pending save would store services that are being replaced, the next change schedules it again
+	saveTimer.stop();
+}
+
+void RepositoryCache::save()
+{
+	saveTimer.stop();
+
+	// Write to a temporary file first, so a crash never leaves a partial cache behind
+	QSaveFile file(fileName);
+	if(!file.open(QIODevice::WriteOnly)) {
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_0);
+
+	QMap<QByteArray, QMdnsEngine::Service> &services = serviceRepository.getServices();
+	QMap<QByteArray, QList<QString>> &addresses = serviceRepository.getAddresses();
+	QMap<QByteArray, QList<QString>> &paths = serviceRepository.getPaths();
+	stream << Magic << Version << serviceRepository.getEpoch() << serviceRepository.getRevision() << quint32(services.size());
+	for(auto it = services.begin(); it != services.end(); it++) {
+		stream << it.key() << it->name() << it->type() << it->hostname() << it->port() << it->attributes() << addresses.value(it.key()) << paths.value(it.key());
+	}
+
+	if(stream.status() == QDataStream::Ok) {
+		file.commit();
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef REPOSITORYCACHE_H
+#define REPOSITORYCACHE_H
+
+#include <QTimer>
+#include "../common/servicerepository.h"
+
+// Stores the services of the repository on disk together with the server's epoch and revision, so a client can show
+// them immediately on startup and only ask the server for the changes since
+// The server picks a new epoch whenever it starts, so this only saves a full snapshot when the client restarts
+class RepositoryCache : public QObject
+{
+	Q_OBJECT
+
+	private:
+		ServiceRepository &serviceRepository;
+		QString fileName;
+
+		QTimer saveTimer;
+
+	public:
+		RepositoryCache(ServiceRepository &serviceRepository, const QString &fileName);
+		~RepositoryCache();
+
+		bool load();
+
+	public slots:
+		void scheduleSave();
+		void cancelSave();
+		void save();
+};
+
+#endif
@@ -0,0 +1,44 @@
+#include "servicefiltermodel.h"
+
+ServiceFilterModel::ServiceFilterModel(ServiceIndex &serviceIndex, QObject *parent) :
+	QSortFilterProxyModel(parent),
+	serviceIndex(serviceIndex)
+{
+}
+
+bool ServiceFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+	if(query.isEmpty()) {
+		return true;
+	}
+
+	QModelIndex index = sourceModel()->index(sourceRow, 0, sourceParent);
+	return matches.contains(index.data().toString().toUtf8());
+}
+
+void ServiceFilterModel::setQuery(const QString &query)
+{
+	// Look up the matching services once, instead of matching every row
+	this->query = query.trimmed();
+	matches = serviceIndex.search(this->query);
+	invalidateFilter();
+}
+
+void ServiceFilterModel::updateService(const QByteArray &fullName)
+{
+	// Keep the matches up to date, the row itself is filtered again when the source model reports the change
+	if(query.isEmpty()) {
+		return;
+	}
+
+	if(serviceIndex.matches(fullName, query)) {
+		matches.insert(fullName);
+	} else {
+		matches.remove(fullName);
+	}
+}
+
+void ServiceFilterModel::removeService(const QByteArray &fullName)
+{
+	matches.remove(fullName);
+}
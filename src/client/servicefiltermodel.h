@@ -0,0 +1,29 @@
+#ifndef SERVICEFILTERMODEL_H
+#define SERVICEFILTERMODEL_H
+
+#include <QSortFilterProxyModel>
+#include "../common/serviceindex.h"
+
+// Sorts the services and only accepts those matching the search query according to the index
+class ServiceFilterModel : public QSortFilterProxyModel
+{
+	Q_OBJECT
+
+	private:
+		ServiceIndex &serviceIndex;
+
+		QString query;
+		QSet<QByteArray> matches;
+
+	protected:
+		bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+
+	public:
+		ServiceFilterModel(ServiceIndex &serviceIndex, QObject *parent = nullptr);
+
+		void setQuery(const QString &query);
+		void updateService(const QByteArray &fullName);
+		void removeService(const QByteArray &fullName);
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "servicemodel.h"
+#include <algorithm>
+
+// Changes are applied to the view at most 30 times per second, however fast they arrive
+static const int FrameInterval = 1000 / 30;
+
+ServiceModel::ServiceModel(ServiceRepository &serviceRepository, QObject *parent) :
+	QAbstractListModel(parent),
+	serviceRepository(serviceRepository),
+	frameTimer(this)
+{
+	// Register event handlers
+	connect(&frameTimer, &QTimer::timeout, this, &ServiceModel::flush);
+
+	frameTimer.setSingleShot(true);
+	frameTimer.setInterval(FrameInterval);
+}
+
+int ServiceModel::rowCount(const QModelIndex &parent) const
+{
+	return parent.isValid() ? 0 : fullNames.size();
+}
+
+QVariant ServiceModel::data(const QModelIndex &index, int role) const
+{
+	if(!index.isValid() || index.row() >= fullNames.size()) {
+		return QVariant();
+	}
+
+	const QByteArray &fullName = fullNames[index.row()];
+	switch(role) {
+		case Qt::DisplayRole: {
+			return QString(fullName);
+		}
+		case Qt::ToolTipRole: {
+			QMdnsEngine::Service service = serviceRepository.getServices().value(fullName);
+			return QString(service.hostname()) + ":" + QString::number(service.port());
+		}
+		default: {
+			return QVariant();
+		}
+	}
+}
+
+bool ServiceModel::contains(const QByteArray &fullName) const
+{
+	return (rows.contains(fullName) && !pendingRemovals.contains(fullName)) || pendingInsertionNames.contains(fullName);
+}
+
+void ServiceModel::addService(const QByteArray &fullName)
+{
+	// A service that is removed and added again within a batch just stays
+	if(pendingRemovals.remove(fullName) || rows.contains(fullName)) {
+		updateService(fullName);
+		return;
+	}
+
+	if(!pendingInsertionNames.contains(fullName)) {
+		pendingInsertions.append(fullName);
+		pendingInsertionNames.insert(fullName);
+		scheduleFlush();
+	}
+}
+
+void ServiceModel::updateService(const QByteArray &fullName)
+{
+	// Services that are not displayed yet show their latest state once inserted
+	if(rows.contains(fullName)) {
+		pendingUpdates.insert(fullName);
+	}
+
+	// Also flush when nothing changed in the list, so the next frame is still signaled
+	scheduleFlush();
+}
+
+void ServiceModel::removeService(const QByteArray &fullName)
+{
+	if(pendingInsertionNames.remove(fullName)) {
+		pendingInsertions.removeOne(fullName);
+		return;
+	}
+
+	if(rows.contains(fullName)) {
+		pendingRemovals.insert(fullName);
+		scheduleFlush();
+	}
+}
+
+void ServiceModel::scheduleFlush()
+{
+	// Apply all changes made until the next frame at once
+	if(!frameTimer.isActive()) {
+		frameTimer.start();
+	}
+}
+
+void ServiceModel::flush()
+{
+	frameTimer.stop();
+
+	// Repaint each changed row once, no matter how often it changed during the frame
+	for(const auto &fullName : pendingUpdates) {
+		auto row = rows.find(fullName);
+		if(row != rows.end() && !pendingRemovals.contains(fullName)) {
+			QModelIndex modelIndex = index(*row);
+			emit dataChanged(modelIndex, modelIndex);
+		}
+	}
+	pendingUpdates.clear();
+
+	// Remove rows from the back, one range of consecutive rows at a time
+	if(!pendingRemovals.isEmpty()) {
+		QList<int> removedRows;
+		for(const auto &fullName : pendingRemovals) {
+			removedRows.append(rows.value(fullName));
+		}
+		std::sort(removedRows.begin(), removedRows.end(), std::greater<int>());
+		pendingRemovals.clear();
+
+		int i = 0;
+		while(i < removedRows.size()) {
+			int last = removedRows[i];
+			int first = last;
+			while(++i < removedRows.size() && removedRows[i] == first - 1) {
+				first--;
+			}
+
+			beginRemoveRows(QModelIndex(), first, last);
+			fullNames.erase(fullNames.begin() + first, fullNames.begin() + last + 1);
+			endRemoveRows();
+		}
+
+		// Rebuild the index once for all removals
+		rows.clear();
+		rows.reserve(fullNames.size());
+		for(int row = 0; row < fullNames.size(); row++) {
+			rows.insert(fullNames[row], row);
+		}
+	}
+
+	// Append all new rows at once
+	if(!pendingInsertions.isEmpty()) {
+		int first = fullNames.size();
+		beginInsertRows(QModelIndex(), first, first + pendingInsertions.size() - 1);
+		for(const auto &fullName : pendingInsertions) {
+			rows.insert(fullName, fullNames.size());
+			fullNames.append(fullName);
+		}
+		pendingInsertions.clear();
+		pendingInsertionNames.clear();
+		endInsertRows();
+	}
+
+	emit flushed();
+}
@@ -0,0 +1,47 @@
+#ifndef SERVICEMODEL_H
+#define SERVICEMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include "../common/servicerepository.h"
+
+// List model over the services in the repository, changes are collected and applied at most once per frame
+class ServiceModel : public QAbstractListModel
+{
+	Q_OBJECT
+
+	private:
+		ServiceRepository &serviceRepository;
+
+		QList<QByteArray> fullNames;
+		QHash<QByteArray, int> rows;
+
+		QList<QByteArray> pendingInsertions;
+		QSet<QByteArray> pendingInsertionNames;
+		QSet<QByteArray> pendingRemovals;
+		QSet<QByteArray> pendingUpdates;
+		QTimer frameTimer;
+
+		void scheduleFlush();
+
+	public:
+		ServiceModel(ServiceRepository &serviceRepository, QObject *parent = nullptr);
+
+		int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+		QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+		bool contains(const QByteArray &fullName) const;
+		void addService(const QByteArray &fullName);
+		void updateService(const QByteArray &fullName);
+		void removeService(const QByteArray &fullName);
+
+	signals:
+		void flushed();
+
+	public slots:
+		void flush();
+};
+
+#endif
@@ -0,0 +1,389 @@
+#include "clientsocket.h"
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QUrlQuery>
+#include <QtEndian>
+#if(QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+#include <QRandomGenerator>
+#define USE_QRANDOMGENERATOR
+#else
+#include <QDateTime>
+#endif
+#include "messagetype.h"
+
+// The connection is aborted after this many pings without any response
+static const int MaxMissedPings = 3;
+
+ClientSocket::ClientSocket(ServiceRepository &serviceRepository, ServiceIndex *serviceIndex, const QString &url, int maxRetries, int retryInterval, int maxRetryInterval, int refreshInterval, int pingInterval, bool compression, bool streamSnapshot, bool verbose) :
+	QObject(),
+	serviceRepository(serviceRepository),
+	serviceIndex(serviceIndex),
+	url(url),
+	compression(compression),
+	streamSnapshot(streamSnapshot),
+	maxRetries(maxRetries),
+	retryInterval(retryInterval),
+	maxRetryInterval(qMax(retryInterval, maxRetryInterval)),
+	refreshInterval(refreshInterval),
+	pingInterval(pingInterval),
+	verbose(verbose),
+	connected(false),
+	retries(0),
+	webSocket(QString(), QWebSocketProtocol::VersionLatest, this),
+	refreshTimer(this),
+	pingTimer(this),
+	synchronizing(false),
+	snapshotRevision(0)
+{
+	if(verbose) qDebug() << "Searching for server on" << url;
+
+#ifndef USE_QRANDOMGENERATOR
+	// Clients started at the same time must not pick the same retry delays
+	qsrand(uint(QDateTime::currentMSecsSinceEpoch() ^ QCoreApplication::applicationPid()));
+#endif
+
+	// Only the revisions received from the server are meaningful, so the repository mustn't count its own
+	serviceRepository.setCountRevisions(false);
+
+	// Observe the repository, before the GUI does so the search index is up to date when the GUI is notified
+	serviceRepository.addObserver(this);
+
+	// Index the services that are already known, for example restored from the cache
+	if(serviceIndex) {
+		QMap<QByteArray, QMdnsEngine::Service> &services = serviceRepository.getServices();
+		for(auto it = services.begin(); it != services.end(); it++) {
+			serviceIndex->addOrUpdateService(it.key(), *it, serviceRepository.getAddresses().value(it.key()));
+		}
+	}
+
+	// Register event handlers
+	connect(&webSocket, &QWebSocket::connected, this, &ClientSocket::onConnected);
+	connect(&webSocket, &QWebSocket::disconnected, this, &ClientSocket::onDisconnected);
+	connect(&webSocket, &QWebSocket::textMessageReceived, this, &ClientSocket::onTextMessageReceived);
+	connect(&webSocket, &QWebSocket::binaryMessageReceived, this, &ClientSocket::onBinaryMessageReceived);
+	connect(&webSocket, &QWebSocket::pong, this, &ClientSocket::onPong);
+	connect(&refreshTimer, &QTimer::timeout, this, &ClientSocket::refreshServices);
+	connect(&pingTimer, &QTimer::timeout, this, &ClientSocket::onPingTimeout);
+
+	// Open the websocket connection
+	webSocket.open(getUrl());
+}
+
+QUrl ClientSocket::getUrl() const
+{
+	// Ask the server to compress large messages and to send snapshots in chunks
+	QUrl url(this->url);
+	QUrlQuery query(url);
+	if(compression) {
+		query.addQueryItem("compression", "deflate");
+	}
+	if(streamSnapshot) {
+		query.addQueryItem("snapshot", "stream");
+	}
+
+	// Only ask for the changes when the services of an earlier revision are known
+	if(!serviceRepository.getEpoch().isEmpty()) {
+		query.addQueryItem("epoch", serviceRepository.getEpoch());
+		query.addQueryItem("since", QString::number(serviceRepository.getRevision()));
+	}
+
+	url.setQuery(query);
+	return url;
+}
+
+void ClientSocket::setRevision(const QJsonObject &jsonMessage)
+{
+	// Mirror the revision of the server, instead of the one counted by the repository
+	if(jsonMessage.contains("epoch")) {
+		serviceRepository.setEpoch(jsonMessage["epoch"].toString().toUtf8());
+	}
+	if(jsonMessage.contains("revision")) {
+		serviceRepository.setRevision(quint64(jsonMessage["revision"].toDouble()));
+	}
+}
+
+ClientSocket::~ClientSocket()
+{
+	// Close the websocket connection
+	webSocket.close();
+}
+
+void ClientSocket::onConnected()
+{
+	if(verbose) qDebug() << "Connected";
+
+	// Store that a connection was established and reset the amount of retries
+	connected = true;
+	retries = 0;
+
+	// Start the refresh timer
+	if(refreshInterval >= 0) {
+		refreshTimer.start(refreshInterval);
+	}
+
+	// Start pinging the server
+	synchronizing = false;
+	lastSeen.start();
+	if(pingInterval > 0) {
+		pingTimer.start(pingInterval);
+	}
+}
+
+void ClientSocket::onDisconnected()
+{
+	if(verbose) connected
+		? qDebug() << "Disconnected"
+		: qDebug();
+
+	// Stop the refresh and ping timers
+	if(connected && refreshInterval >= 0) {
+		refreshTimer.stop();
+	}
+	pingTimer.stop();
+
+	// Retry connection after a few ms if the maximum amount of retries hasn't been reached
+	if(maxRetries < 0 || retries < maxRetries) {
+		if(verbose) connected
+			? qDebug() << "Reconnecting ..."
+			: qDebug() << "Timeout. Retrying ...";
+
+		QTimer::singleShot(getRetryDelay(), this, &ClientSocket::onReconnect);
+		retries++;
+	}
+	// Quit the application
+	else {
+		if(verbose) maxRetries != 0
+			? qDebug() << "Timeout. Maximum amount of retries reached. Quitting application"
+			: qDebug();
+
+		QCoreApplication::quit();
+	}
+}
+
+int ClientSocket::getRetryDelay() const
+{
+	// Double the interval with every retry up to the maximum, then pick a random delay up to that interval so clients
+	// that lost their connection at the same time don't reconnect at the same time
+	quint32 interval = quint32(qMin(qint64(maxRetryInterval), qint64(retryInterval) << qMin(retries, 30)));
+#ifdef USE_QRANDOMGENERATOR
+	return int(QRandomGenerator::global()->bounded(interval + 1));
+#else
+	return int(quint32(qrand()) % (interval + 1));
+#endif
+}
+
+void ClientSocket::onReconnect()
+{
+	// Store that a connection isn't established anymore
+	if(connected) {
+		connected = false;
+	}
+
+	// Reset and reopen the websocket connection
+	webSocket.abort();
+	webSocket.open(getUrl());
+}
+
+void ClientSocket::onTextMessageReceived(const QString &message)
+{
+	processMessage(message.toUtf8());
+}
+
+void ClientSocket::onBinaryMessageReceived(const QByteArray &message)
+{
+	// Binary messages are text messages compressed as zlib streams, qUncompress() expects them to be
+	// prefixed with the uncompressed length, which it only uses as the initial size of its buffer
+	QByteArray prefixed(4, 0);
+	qToBigEndian<quint32>(quint32(qMin<qint64>(qint64(message.size()) * 4, 0xffffff)), reinterpret_cast<uchar *>(prefixed.data()));
+	QByteArray json = qUncompress(prefixed + message);
+	if(json.isEmpty()) {
+		if(verbose) qDebug() << "Invalid compressed message";
+		return;
+	}
+
+	processMessage(json);
+}
+
+void ClientSocket::processMessage(const QByteArray &message)
+{
+	QJsonDocument jsonDocument = QJsonDocument::fromJson(message);
+	QJsonObject jsonMessage = jsonDocument.object();
+	lastSeen.restart();
+
+	switch(jsonMessage["type"].toInt()) {
+		case MessageType::ALL: {
+			if(verbose) serviceRepository.getServices().empty()
+				? qDebug()
+				: qDebug() << "\e[33mREFRESH\e[0m";
+
+			// Only apply the differences with the current services, so an unchanged refresh notifies nothing
+			serviceRepository.applySnapshot(jsonMessage["services"].toArray());
+			setRevision(jsonMessage);
+			synchronizing = false;
+			break;
+		}
+		case MessageType::ALL_BEGIN: {
+			if(verbose) serviceRepository.getServices().empty()
+				? qDebug()
+				: qDebug() << "\e[33mREFRESH\e[0m";
+
+			// Keep the current services until the end of the snapshot, so the services remain visible meanwhile
+			snapshotServices.clear();
+			snapshotRevision = quint64(jsonMessage["revision"].toDouble());
+			snapshotEpoch = jsonMessage["epoch"].toString().toUtf8();
+
+			// The services are only consistent again at the end of the snapshot, so don't report a change before
+			emit snapshotStarted();
+			return;
+		}
+		case MessageType::ALL_CHUNK: {
+			for(const auto &jsonService : jsonMessage["services"].toArray()) {
+				snapshotServices.insert(serviceRepository.addOrUpdateIfChanged(jsonService.toObject()));
+			}
+			return;
+		}
+		case MessageType::ALL_END: {
+			// Remove the services that are no longer part of the snapshot
+			serviceRepository.removeAllExcept(snapshotServices);
+			snapshotServices.clear();
+
+			// Only now the services are at the revision of the snapshot
+			serviceRepository.setEpoch(snapshotEpoch);
+			serviceRepository.setRevision(snapshotRevision);
+			synchronizing = false;
+			break;
+		}
+		case MessageType::DELTA: {
+			if(verbose) qDebug() << "\e[33mCHANGES\e[0m since revision" << serviceRepository.getRevision();
+
+			for(const auto &jsonService : jsonMessage["services"].toArray()) {
+				serviceRepository.addOrUpdateIfChanged(jsonService.toObject());
+			}
+			for(const auto &jsonFullName : jsonMessage["removed"].toArray()) {
+				serviceRepository.removeIfExists(jsonFullName.toString().toUtf8());
+			}
+			setRevision(jsonMessage);
+			synchronizing = false;
+			break;
+		}
+		case MessageType::ADD_OR_UPDATE: {
+			serviceRepository.addOrUpdateIfChanged(jsonMessage["service"].toObject());
+			setRevision(jsonMessage);
+			break;
+		}
+		case MessageType::HEARTBEAT: {
+			// Only ask for the missed changes when the revision of the server differs, nothing changed otherwise
+			bool diverged = jsonMessage["epoch"].toString().toUtf8() != serviceRepository.getEpoch()
+				|| quint64(jsonMessage["revision"].toDouble()) != serviceRepository.getRevision();
+			if(diverged && !synchronizing) {
+				if(verbose) qDebug() << "Revision" << serviceRepository.getRevision() << "differs from server revision" << quint64(jsonMessage["revision"].toDouble());
+				synchronizeServices();
+			}
+			return;
+		}
+		case MessageType::REMOVE: {
+			serviceRepository.removeIfExists(jsonMessage["fullname"].toString().toUtf8());
+			setRevision(jsonMessage);
+			break;
+		}
+		default: {
+			if(verbose) qDebug() << "Unsupported message type" << jsonMessage["type"].toInt();
+			return;
+		}
+	}
+
+	emit changed();
+}
+
+void ClientSocket::onAddOrUpdateService(const QMdnsEngine::Service &service)
+{
+	// Differentiate between service types of the same service
+	QByteArray fullName = serviceRepository.getServiceFullName(service);
+
+	if(verbose) qDebug() << "\e[32mADDED OR UPDATED\e[0m" << fullName;
+
+	if(serviceIndex) {
+		serviceIndex->addOrUpdateService(fullName, service, serviceRepository.getAddresses().value(fullName));
+	}
+
+	if(verbose) printService(service);
+}
+
+void ClientSocket::onRemoveService(const QString &fullName)
+{
+	if(verbose) qDebug() << "\e[31mREMOVED\e[0m" << fullName;
+
+	if(serviceIndex) {
+		serviceIndex->removeService(fullName.toUtf8());
+	}
+}
+
+void ClientSocket::printService(const QMdnsEngine::Service &service)
+{
+	// Differentiate between service types of the same service
+	QByteArray fullName = serviceRepository.getServiceFullName(service);
+
+	qDebug() << "-----" << fullName << "-----";
+
+	qDebug() << "\e[34mINFO\e[0m" << "Name:" << service.name();
+	qDebug() << "\e[34mINFO\e[0m" << "Hostname:" << service.hostname();
+	qDebug() << "\e[34mINFO\e[0m" << "Port:" << service.port();
+	qDebug() << "\e[34mINFO\e[0m" << "Type:" << service.type();
+	qDebug() << "\e[34mINFO\e[0m" << "Fullname:" << fullName;
+
+	QMap<QByteArray, QByteArray> attributes = service.attributes();
+	qDebug() << "\e[34mINFO\e[0m" << "Attributes:" << (attributes.empty() ? "none" : "");
+	for(auto it = attributes.begin(); it != attributes.end(); it++) {
+		qDebug() << "\e[34mINFO\e[0m" << "\t" << it.key() << "->" << it.value();
+	}
+
+	QList<QString> &addresses = serviceRepository.getAddresses()[fullName];
+	qDebug() << "\e[34mINFO\e[0m" << "Addresses:" << (addresses.empty() ? "none" : "");
+	for(const auto &address : addresses) {
+		qDebug() << "\e[34mINFO\e[0m" << "\t" << address;
+	}
+}
+
+void ClientSocket::refreshServices()
+{
+	// Restarts the refresh timer if the refresh was called manually
+	if(!sender() && refreshInterval >= 0) {
+		refreshTimer.start(refreshInterval);
+	}
+
+	QJsonObject jsonMessage;
+	jsonMessage["type"] = MessageType::REFRESH;
+	QJsonDocument jsonDocument(jsonMessage);
+	webSocket.sendTextMessage(jsonDocument.toJson());
+}
+
+void ClientSocket::synchronizeServices()
+{
+	// The server answers with the changes since this revision, or all services if it doesn't remember them
+	QJsonObject jsonMessage;
+	jsonMessage["type"] = MessageType::SYNC;
+	jsonMessage["epoch"] = QString(serviceRepository.getEpoch());
+	jsonMessage["since"] = QString::number(serviceRepository.getRevision());
+	QJsonDocument jsonDocument(jsonMessage);
+	webSocket.sendTextMessage(jsonDocument.toJson(QJsonDocument::Compact));
+	synchronizing = true;
+}
+
+void ClientSocket::onPingTimeout()
+{
+	// Give up on a connection that didn't respond to several pings, which reconnects after the disconnect
+	if(lastSeen.elapsed() > MaxMissedPings * pingInterval) {
+		if(verbose) qDebug() << "Server stopped responding";
+		webSocket.abort();
+		return;
+	}
+
+	webSocket.ping();
+}
+
+void ClientSocket::onPong()
+{
+	lastSeen.restart();
+}
\ No newline at end of file
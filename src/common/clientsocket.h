@@ -0,0 +1,78 @@
+#ifndef CLIENTSOCKET_H
+#define CLIENTSOCKET_H
+
+#include <QWebSocket>
+#include <QTimer>
+#include <QElapsedTimer>
+#include "servicerepository.h"
+#include "serviceindex.h"
+
+class ClientSocket : public QObject, public Observer
+{
+	Q_OBJECT
+
+	private:
+		ServiceRepository &serviceRepository;
+		ServiceIndex *serviceIndex;
+		QUrl url;
+		bool compression;
+		bool streamSnapshot;
+		int maxRetries;
+		int retryInterval;
+		int maxRetryInterval;
+		int refreshInterval;
+		int pingInterval;
+		bool verbose;
+
+		bool connected;
+		int retries;
+		QWebSocket webSocket;
+		QTimer refreshTimer;
+
+		// Detects a server that stopped responding and only resynchronizes when the revisions diverge
+		QTimer pingTimer;
+		QElapsedTimer lastSeen;
+		bool synchronizing;
+
+		QSet<QByteArray> snapshotServices;
+		quint64 snapshotRevision;
+		QByteArray snapshotEpoch;
+
+		QUrl getUrl() const;
+		void setRevision(const QJsonObject &jsonMessage);
+		int getRetryDelay() const;
+
+		void processMessage(const QByteArray &message);
+		void printService(const QMdnsEngine::Service &service);
+
+	public:
+		// URL: 'ws://' is the non-SSL version, 'wss://' is the SSL version
+		// The search index is optional and not kept when null
+		ClientSocket(ServiceRepository &serviceRepository, ServiceIndex *serviceIndex, const QString &url, int maxRetries, int retryInterval, int maxRetryInterval, int refreshInterval, int pingInterval, bool compression, bool streamSnapshot, bool verbose);
+		~ClientSocket();
+		
+		void refreshServices();
+		void synchronizeServices();
+
+		// Keeps the search index in sync with the changes applied to the repository
+		void onAddOrUpdateService(const QMdnsEngine::Service &service) override;
+		void onRemoveService(const QString &fullName) override;
+
+	signals:
+		// Emitted after a message from the server was applied to the repository
+		void changed();
+
+		// Emitted when a snapshot streamed in chunks starts, the repository is incomplete until the next change
+		void snapshotStarted();
+
+	private slots:
+		void onConnected();
+		void onDisconnected();
+		void onReconnect();
+		void onPingTimeout();
+		void onPong();
+		void onTextMessageReceived(const QString &message);
+		void onBinaryMessageReceived(const QByteArray &message);
+};
+
+#endif
\ No newline at end of file
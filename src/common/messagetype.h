@@ -7,7 +7,13 @@ enum MessageType
 	ALL,
 	ADD_OR_UPDATE,
 	REMOVE,
-	REFRESH	// Client can manually ask for a refresh
+	REFRESH,	// Client can manually ask for a refresh
+	ALL_BEGIN,	// Start of a snapshot streamed in chunks
+	ALL_CHUNK,
+	ALL_END,
+	DELTA,	// Changes since the revision the client already has
+	HEARTBEAT,	// Current revision, so clients can detect they missed changes
+	SYNC	// Client asks for the changes since its revision
 };
 
 #endif
\ No newline at end of file
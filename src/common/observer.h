@@ -9,6 +9,9 @@ class Observer
 		virtual ~Observer() {}
 		virtual void onAddOrUpdateService(const QMdnsEngine::Service &service) = 0;
 		virtual void onRemoveService(const QString &fullName) = 0;
+
+		// The revision jumped instead of counting the changes, for example after following another repository
+		virtual void onResetRevision() {}
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "serviceindex.h"
+
+QSet<QByteArray> ServiceIndex::getGrams(const QByteArray &text)
+{
+	// Index the trigrams only, shorter queries are answered by scanning the texts, terms are separated by newlines so
+	// no trigram spans two terms
+	QSet<QByteArray> grams;
+	for(const auto &term : text.split('\n')) {
+		for(int i = 0; i + 3 <= term.size(); i++) {
+			grams.insert(term.mid(i, 3));
+		}
+	}
+	return grams;
+}
+
+void ServiceIndex::addOrUpdateService(const QByteArray &fullName, const QMdnsEngine::Service &service, const QList<QString> &addresses)
+{
+	// Collect the searchable terms, case folded so that non-ASCII names match regardless of their case as well
+	QList<QByteArray> terms = {fullName, service.name(), service.type(), service.hostname()};
+	const QMap<QByteArray, QByteArray> attributes = service.attributes();
+	for(auto it = attributes.constBegin(); it != attributes.constEnd(); it++) {
+		terms.append(it.key());
+		terms.append(it.value());
+	}
+	for(const auto &address : addresses) {
+		terms.append(address.toUtf8());
+	}
+	QByteArray text = QString::fromUtf8(terms.join('\n')).toCaseFolded().toUtf8();
+
+	// Nothing to do when the searchable text didn't change
+	int id = ids.value(fullName, -1);
+	if(id >= 0 && texts[id] == text) {
+		return;
+	}
+
+	QSet<QByteArray> grams = getGrams(text);
+	if(id >= 0) {
+		// Only update the postings of grams that were added or removed
+		QSet<QByteArray> oldGrams = getGrams(texts[id]);
+		for(const auto &gram : oldGrams) {
+			if(!grams.contains(gram)) {
+				auto posting = postings.find(gram);
+				posting->remove(id);
+				if(posting->isEmpty()) {
+					postings.erase(posting);
+				}
+			}
+		}
+		for(const auto &gram : grams) {
+			if(!oldGrams.contains(gram)) {
+				postings[gram].insert(id);
+			}
+		}
+	} else {
+		// Reuse the id of a removed service
+		if(!freeIds.isEmpty()) {
+			id = freeIds.takeLast();
+			fullNames[id] = fullName;
+		} else {
+			id = fullNames.size();
+			fullNames.append(fullName);
+			texts.append(QByteArray());
+		}
+		ids.insert(fullName, id);
+
+		for(const auto &gram : grams) {
+			postings[gram].insert(id);
+		}
+	}
+	texts[id] = text;
+}
+
+void ServiceIndex::removeService(const QByteArray &fullName)
+{
+	int id = ids.value(fullName, -1);
+	if(id < 0) {
+		return;
+	}
+
+	for(const auto &gram : getGrams(texts[id])) {
+		auto posting = postings.find(gram);
+		posting->remove(id);
+		if(posting->isEmpty()) {
+			postings.erase(posting);
+		}
+	}
+
+	ids.remove(fullName);
+	fullNames[id].clear();
+	texts[id].clear();
+	freeIds.append(id);
+}
+
+void ServiceIndex::clear()
+{
+	ids.clear();
+	fullNames.clear();
+	texts.clear();
+	freeIds.clear();
+	postings.clear();
+}
+
+QList<QByteArray> ServiceIndex::getQueryGrams(const QByteArray &query)
+{
+	// Split queries into consecutive trigrams, the last one overlapping the previous one to cover the whole query
+	QList<QByteArray> grams;
+	for(int i = 0; i + 3 <= query.size(); i += 3) {
+		grams.append(query.mid(i, 3));
+	}
+	if(query.size() % 3 != 0) {
+		grams.append(query.right(3));
+	}
+	return grams;
+}
+
+QSet<QByteArray> ServiceIndex::search(const QString &query) const
+{
+	QSet<QByteArray> results;
+	QByteArray foldedQuery = query.toCaseFolded().toUtf8();
+	if(foldedQuery.isEmpty()) {
+		return results;
+	}
+
+	// Queries shorter than a trigram are rare and would match most services anyway, so scan all texts
+	if(foldedQuery.size() < 3) {
+		for(int id = 0; id < texts.size(); id++) {
+			if(texts[id].contains(foldedQuery)) {
+				results.insert(fullNames[id]);
+			}
+		}
+		return results;
+	}
+
+	// Find the smallest posting among the grams of the query, a missing gram means nothing matches
+	const QSet<int> *smallest = nullptr;
+	QList<const QSet<int> *> others;
+	for(const auto &gram : getQueryGrams(foldedQuery)) {
+		auto posting = postings.constFind(gram);
+		if(posting == postings.constEnd()) {
+			return results;
+		}
+		if(!smallest || posting->size() < smallest->size()) {
+			if(smallest) {
+				others.append(smallest);
+			}
+			smallest = &*posting;
+		} else {
+			others.append(&*posting);
+		}
+	}
+
+	// Intersect the postings, then verify the remaining candidates as trigrams can match in the wrong order
+	for(int id : *smallest) {
+		bool candidate = true;
+		for(const auto &posting : others) {
+			if(!posting->contains(id)) {
+				candidate = false;
+				break;
+			}
+		}
+		if(candidate && (foldedQuery.size() == 3 || texts[id].contains(foldedQuery))) {
+			results.insert(fullNames[id]);
+		}
+	}
+
+	return results;
+}
+
+bool ServiceIndex::matches(const QByteArray &fullName, const QString &query) const
+{
+	int id = ids.value(fullName, -1);
+	return id >= 0 && texts[id].contains(query.toCaseFolded().toUtf8());
+}
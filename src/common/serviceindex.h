@@ -0,0 +1,32 @@
+#ifndef SERVICEINDEX_H
+#define SERVICEINDEX_H
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <qmdnsengine/service.h>
+
+// Trigram index over the searchable text of services, queries only verify the services that contain all trigrams and
+// queries shorter than a trigram scan all services
+class ServiceIndex
+{
+	private:
+		QHash<QByteArray, int> ids;
+		QVector<QByteArray> fullNames;
+		QVector<QByteArray> texts;
+		QVector<int> freeIds;
+		QHash<QByteArray, QSet<int>> postings;
+
+		static QSet<QByteArray> getGrams(const QByteArray &text);
+		static QList<QByteArray> getQueryGrams(const QByteArray &query);
+
+	public:
+		void addOrUpdateService(const QByteArray &fullName, const QMdnsEngine::Service &service, const QList<QString> &addresses);
+		void removeService(const QByteArray &fullName);
+		void clear();
+
+		QSet<QByteArray> search(const QString &query) const;
+		bool matches(const QByteArray &fullName, const QString &query) const;
+};
+
+#endif
@@ -1,4 +1,13 @@
 #include "servicerepository.h"
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <qmdnsengine/trace.h>
+
+ServiceRepository::ServiceRepository() :
+	revision(0),
+	countRevisions(true)
+{
+}
 
 QMap<QByteArray, QMdnsEngine::Service>& ServiceRepository::getServices()
 {
@@ -10,22 +19,224 @@ QMap<QByteArray, QList<QString>>& ServiceRepository::getAddresses()
 	return addresses;
 }
 
+QMap<QByteArray, QByteArray>& ServiceRepository::getFragments()
+{
+	return fragments;
+}
+
+QMap<QByteArray, QList<QString>>& ServiceRepository::getPaths()
+{
+	return paths;
+}
+
 QByteArray ServiceRepository::getServiceFullName(const QMdnsEngine::Service &service)
 {
 	return service.name() + "." + service.type();
 }
 
-void ServiceRepository::setObserver(Observer *observer)
+const QByteArray& ServiceRepository::getJsonService(const QMdnsEngine::Service &service)
+{
+	// Differentiate between service types of the same service
+	QByteArray fullName = getServiceFullName(service);
+
+	// Reuse the encoded service until a change is reported
+	auto fragment = fragments.find(fullName);
+	if(fragment != fragments.end()) {
+		return *fragment;
+	}
+
+	QMDNSENGINE_TRACE_SPAN("encodeService", "repository");
+
+	QJsonObject jsonService;
+	jsonService["name"] = QString(service.name());
+	jsonService["hostname"] = QString(service.hostname());
+	jsonService["port"] = service.port();
+	jsonService["type"] = QString(service.type());
+	jsonService["fullname"] = QString(fullName);
+
+	QJsonObject jsonAttributes;
+	const QMap<QByteArray, QByteArray> attributes = service.attributes();
+	for(auto it = attributes.constBegin(); it != attributes.constEnd(); it++) {
+		jsonAttributes[it.key()] = QString(it.value());
+	}
+	jsonService["attributes"] = jsonAttributes;
+
+	QJsonArray jsonAddresses;
+	for(const auto &address : addresses.value(fullName)) {
+		jsonAddresses.append(address);
+	}
+	jsonService["addresses"] = jsonAddresses;
+
+	// Services from other servers keep their path, so servers federating each other can detect loops
+	QList<QString> path = paths.value(fullName);
+	if(!origin.isEmpty()) {
+		path.append(origin);
+	}
+	if(!path.isEmpty()) {
+		jsonService["path"] = QJsonArray::fromStringList(path);
+	}
+
+	return *fragments.insert(fullName, QJsonDocument(jsonService).toJson(QJsonDocument::Compact));
+}
+
+QMdnsEngine::Service ServiceRepository::parseJsonService(const QJsonObject &jsonService, QList<QString> &addresses, QList<QString> &path)
+{
+	QMdnsEngine::Service service;
+
+	service.setName(jsonService["name"].toString().toUtf8());
+	service.setHostname(jsonService["hostname"].toString().toUtf8());
+	service.setPort(jsonService["port"].toInt());
+	service.setType(jsonService["type"].toString().toUtf8());
+
+	QJsonObject jsonAttributes = jsonService["attributes"].toObject();
+	for(auto it = jsonAttributes.begin(); it != jsonAttributes.end(); it++) {
+		service.addAttribute(it.key().toUtf8(), it.value().toString().toUtf8());
+	}
+
+	addresses.clear();
+	for(const auto &jsonAddress : jsonService["addresses"].toArray()) {
+		addresses.append(jsonAddress.toString());
+	}
+
+	path.clear();
+	for(const auto &jsonServer : jsonService["path"].toArray()) {
+		path.append(jsonServer.toString());
+	}
+
+	return service;
+}
+
+QByteArray ServiceRepository::addOrUpdateIfChanged(const QJsonObject &jsonService)
+{
+	// Differentiate between service types of the same service
+	QByteArray fullName = jsonService["fullname"].toString().toUtf8();
+
+	QList<QString> serviceAddresses;
+	QList<QString> servicePath;
+	QMdnsEngine::Service service = parseJsonService(jsonService, serviceAddresses, servicePath);
+
+	// Skip services that didn't change, the service comparison ignores the hostname
+	auto existing = services.constFind(fullName);
+	if(existing != services.constEnd() && *existing == service && existing->hostname() == service.hostname() && addresses.value(fullName) == serviceAddresses && paths.value(fullName) == servicePath) {
+		return fullName;
+	}
+
+	addresses[fullName] = serviceAddresses;
+	services[fullName] = service;
+	if(servicePath.isEmpty()) {
+		paths.remove(fullName);
+	}
+	else {
+		paths[fullName] = servicePath;
+	}
+
+	notifyAddOrUpdateService(service);
+
+	return fullName;
+}
+
+void ServiceRepository::removeIfExists(const QByteArray &fullName)
+{
+	// Changes since a revision can include services this repository never had
+	if(!services.contains(fullName)) {
+		return;
+	}
+
+	services.remove(fullName);
+	addresses.remove(fullName);
+	paths.remove(fullName);
+
+	notifyRemoveService(fullName);
+}
+
+void ServiceRepository::removeAllExcept(const QSet<QByteArray> &fullNames)
+{
+	// Iterate over a copy of the names, since the services are removed meanwhile
+	for(const auto &fullName : services.keys()) {
+		if(!fullNames.contains(fullName)) {
+			removeIfExists(fullName);
+		}
+	}
+}
+
+void ServiceRepository::applySnapshot(const QJsonArray &jsonServices)
+{
+	// Only apply the differences with the current services, so an unchanged snapshot notifies nothing
+	QSet<QByteArray> fullNames;
+	for(const auto &jsonService : jsonServices) {
+		fullNames.insert(addOrUpdateIfChanged(jsonService.toObject()));
+	}
+	removeAllExcept(fullNames);
+}
+
+const QByteArray& ServiceRepository::getEpoch() const
+{
+	return epoch;
+}
+
+quint64 ServiceRepository::getRevision() const
+{
+	return revision;
+}
+
+void ServiceRepository::setEpoch(const QByteArray &epoch)
+{
+	this->epoch = epoch;
+}
+
+void ServiceRepository::setRevision(quint64 revision)
+{
+	this->revision = revision;
+}
+
+void ServiceRepository::setCountRevisions(bool countRevisions)
+{
+	this->countRevisions = countRevisions;
+}
+
+const QString& ServiceRepository::getOrigin() const
+{
+	return origin;
+}
+
+void ServiceRepository::setOrigin(const QString &origin)
 {
-	this->observer = observer;
+	this->origin = origin;
+}
+
+void ServiceRepository::addObserver(Observer *observer)
+{
+	observers.append(observer);
 }
 
 void ServiceRepository::notifyAddOrUpdateService(const QMdnsEngine::Service &service)
 {
-	observer->onAddOrUpdateService(service);
+	// The encoded service is outdated, observers regenerate it when needed
+	fragments.remove(getServiceFullName(service));
+	if(countRevisions) {
+		revision++;
+	}
+
+	for(const auto &observer : observers) {
+		observer->onAddOrUpdateService(service);
+	}
 }
 
 void ServiceRepository::notifyRemoveService(const QString &fullName)
 {
-	observer->onRemoveService(fullName);
+	fragments.remove(fullName.toUtf8());
+	if(countRevisions) {
+		revision++;
+	}
+
+	for(const auto &observer : observers) {
+		observer->onRemoveService(fullName);
+	}
+}
+
+void ServiceRepository::notifyResetRevision()
+{
+	for(const auto &observer : observers) {
+		observer->onResetRevision();
+	}
 }
\ No newline at end of file
@@ -1,6 +1,9 @@
 #ifndef SERVICEREPOSITORY_H
 #define SERVICEREPOSITORY_H
 
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QSet>
 #include "observer.h"
 
 class ServiceRepository
@@ -8,17 +11,54 @@ class ServiceRepository
 	private:
 		QMap<QByteArray, QMdnsEngine::Service> services;
 		QMap<QByteArray, QList<QString>> addresses;
-		Observer *observer;
+		QMap<QByteArray, QByteArray> fragments;
+
+		// The servers a service passed through when federating, starting with the one that discovered it
+		QMap<QByteArray, QList<QString>> paths;
+		QString origin;
+		QList<Observer *> observers;
+
+		// Identifies the repository's history, revisions of different epochs can't be compared
+		QByteArray epoch;
+		quint64 revision;
+		bool countRevisions;
 	
 	public:
+		ServiceRepository();
+
 		QMap<QByteArray, QMdnsEngine::Service>& getServices();
 		QMap<QByteArray, QList<QString>>& getAddresses();
+		QMap<QByteArray, QByteArray>& getFragments();
+		QMap<QByteArray, QList<QString>>& getPaths();
 		QByteArray getServiceFullName(const QMdnsEngine::Service &service);
+
+		// The compact JSON of a service, reused until the service changes
+		const QByteArray& getJsonService(const QMdnsEngine::Service &service);
+		static QMdnsEngine::Service parseJsonService(const QJsonObject &jsonService, QList<QString> &addresses, QList<QString> &path);
+
+		// Apply the services received from another repository, only notifying the observers of actual changes
+		QByteArray addOrUpdateIfChanged(const QJsonObject &jsonService);
+		void removeIfExists(const QByteArray &fullName);
+		void removeAllExcept(const QSet<QByteArray> &fullNames);
+		void applySnapshot(const QJsonArray &jsonServices);
+
+		const QByteArray& getEpoch() const;
+		quint64 getRevision() const;
+		void setEpoch(const QByteArray &epoch);
+		void setRevision(quint64 revision);
+
+		// Repositories mirroring a server only store the revisions set from its messages
+		void setCountRevisions(bool countRevisions);
+
+		// Identifies this server in the paths of the services it sends, empty when not federating
+		const QString& getOrigin() const;
+		void setOrigin(const QString &origin);
 		
-		void setObserver(Observer *observer);
+		void addObserver(Observer *observer);
 
 		void notifyAddOrUpdateService(const QMdnsEngine::Service &service);
 		void notifyRemoveService(const QString &fullName);
+		void notifyResetRevision();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "signalhandler.h"
+#include <QCoreApplication>
+#include <QDebug>
+#ifdef Q_OS_UNIX
+#include <sys/socket.h>
+#include <csignal>
+#include <unistd.h>
+#endif
+
+int SignalHandler::fds[2] = {-1, -1};
+
+SignalHandler::SignalHandler() :
+	QObject()
+{
+#ifdef Q_OS_UNIX
+	if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+		qWarning() << "Failed to create signal socket pair";
+		return;
+	}
+
+	// Register event handlers
+	notifier.reset(new QSocketNotifier(fds[1], QSocketNotifier::Read));
+	connect(notifier.get(), &QSocketNotifier::activated, this, &SignalHandler::onActivated);
+
+	struct sigaction action = {};
+	action.sa_handler = &SignalHandler::onSignal;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGTERM, &action, nullptr);
+#endif
+}
+
+SignalHandler::~SignalHandler()
+{
+#ifdef Q_OS_UNIX
+	if(fds[0] >= 0) {
+		signal(SIGINT, SIG_DFL);
+		signal(SIGTERM, SIG_DFL);
+		notifier.reset();
+		close(fds[0]);
+		close(fds[1]);
+		fds[0] = fds[1] = -1;
+	}
+#endif
+}
+
+void SignalHandler::onSignal(int signal)
+{
+#ifdef Q_OS_UNIX
+	Q_UNUSED(signal);
+	char byte = 1;
+	if(write(fds[0], &byte, sizeof(byte)) < 0) {
+		// Nothing can be done about it inside a signal handler
+	}
+#else
+	Q_UNUSED(signal);
+#endif
+}
+
+void SignalHandler::onActivated()
+{
+#ifdef Q_OS_UNIX
+	char byte;
+	if(read(fds[1], &byte, sizeof(byte)) > 0) {
+		QCoreApplication::quit();
+	}
+#endif
+}
\ No newline at end of file
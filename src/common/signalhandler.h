@@ -0,0 +1,28 @@
+#ifndef SIGNALHANDLER_H
+#define SIGNALHANDLER_H
+
+#include <QObject>
+#include <QSocketNotifier>
+#include <memory>
+
+// Quits the application on SIGINT and SIGTERM, so the destructors of the components run and can store their state.
+// Signal handlers may hardly do anything, so the handler only writes to a pipe that is read by the event loop.
+class SignalHandler : public QObject
+{
+	Q_OBJECT
+
+	private:
+		static int fds[2];
+		std::unique_ptr<QSocketNotifier> notifier;
+
+		static void onSignal(int signal);
+
+	public:
+		SignalHandler();
+		~SignalHandler();
+
+	private slots:
+		void onActivated();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,278 @@
+#include "epolleventdispatcher.h"
+#include <QCoreApplication>
+#include <QSocketNotifier>
+#include <QDebug>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+// Maximum amount of ready file descriptors handled per iteration, the rest is reported again by the next epoll_wait
+static const int MaxEvents = 256;
+
+EpollEventDispatcher::EpollEventDispatcher(QObject *parent) :
+	QAbstractEventDispatcher(parent),
+	epollFd(epoll_create1(EPOLL_CLOEXEC)),
+	wakeUpFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+	wokenUp(0),
+	interrupted(0)
+{
+	if(epollFd < 0 || wakeUpFd < 0) {
+		qFatal("Failed to create epoll event dispatcher: %s", strerror(errno));
+	}
+
+	// Writing to the event file descriptor wakes up a blocked epoll_wait from any thread
+	epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.fd = wakeUpFd;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeUpFd, &event);
+
+	clock.start();
+}
+
+EpollEventDispatcher::~EpollEventDispatcher()
+{
+	close(wakeUpFd);
+	close(epollFd);
+}
+
+bool EpollEventDispatcher::processEvents(QEventLoop::ProcessEventsFlags flags)
+{
+	interrupted.storeRelease(0);
+	emit awake();
+
+	// Events posted meanwhile call wakeUp() again, so waiting below returns immediately for them
+	wokenUp.storeRelease(0);
+	QCoreApplication::sendPostedEvents();
+
+	bool wait = (flags & QEventLoop::WaitForMoreEvents) && !interrupted.loadAcquire();
+	if(wait) {
+		emit aboutToBlock();
+	}
+
+	epoll_event events[MaxEvents];
+	int count = epoll_wait(epollFd, events, MaxEvents, wait ? getTimeout() : 0);
+	if(count < 0 && errno != EINTR) {
+		qWarning() << "epoll_wait failed:" << strerror(errno);
+	}
+	if(wait) {
+		emit awake();
+	}
+
+	// Activate the socket notifiers of the ready file descriptors
+	bool processed = false;
+	for(int i = 0; i < count; i++) {
+		int fd = events[i].data.fd;
+		if(fd == wakeUpFd) {
+			eventfd_t value;
+			eventfd_read(wakeUpFd, &value);
+			processed = true;
+		}
+		// Level triggered, so skipped file descriptors are reported again by a later iteration
+		else if(!(flags & QEventLoop::ExcludeSocketNotifiers)) {
+			processed |= activateSocketNotifiers(fd, events[i].events);
+		}
+	}
+
+	// Activate the timers that expired
+	if(!(flags & QEventLoop::X11ExcludeTimers)) {
+		processed |= activateTimers();
+	}
+
+	return processed;
+}
+
+bool EpollEventDispatcher::hasPendingEvents()
+{
+	// Posting an event wakes up the dispatcher of the receiving thread, which sends it on the next iteration
+	return wokenUp.loadAcquire() != 0;
+}
+
+void EpollEventDispatcher::registerSocketNotifier(QSocketNotifier *notifier)
+{
+	int fd = int(notifier->socket());
+	bool added = !socketNotifiers.contains(fd);
+	SocketNotifiers &notifiers = socketNotifiers[fd];
+	switch(notifier->type()) {
+		case QSocketNotifier::Read: notifiers.read = notifier; break;
+		case QSocketNotifier::Write: notifiers.write = notifier; break;
+		case QSocketNotifier::Exception: notifiers.exception = notifier; break;
+	}
+
+	updateSocketNotifiers(fd, added);
+}
+
+void EpollEventDispatcher::unregisterSocketNotifier(QSocketNotifier *notifier)
+{
+	int fd = int(notifier->socket());
+	auto it = socketNotifiers.find(fd);
+	if(it == socketNotifiers.end()) {
+		return;
+	}
+
+	// Only unregister the notifier if it's the one registered for this file descriptor
+	switch(notifier->type()) {
+		case QSocketNotifier::Read: if(it->read == notifier) it->read = nullptr; break;
+		case QSocketNotifier::Write: if(it->write == notifier) it->write = nullptr; break;
+		case QSocketNotifier::Exception: if(it->exception == notifier) it->exception = nullptr; break;
+	}
+
+	updateSocketNotifiers(fd, false);
+}
+
+void EpollEventDispatcher::updateSocketNotifiers(int fd, bool added)
+{
+	const SocketNotifiers &notifiers = socketNotifiers[fd];
+
+	// Remove file descriptors without any notifiers, they may be closed right after
+	if(!notifiers.read && !notifiers.write && !notifiers.exception) {
+		socketNotifiers.remove(fd);
+		epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+		return;
+	}
+
+	epoll_event event = {};
+	event.events = (notifiers.read ? EPOLLIN : 0) | (notifiers.write ? EPOLLOUT : 0) | (notifiers.exception ? EPOLLPRI : 0);
+	event.data.fd = fd;
+	if(epoll_ctl(epollFd, added ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &event) < 0) {
+		qWarning() << "Failed to register socket notifier for file descriptor" << fd << ":" << strerror(errno);
+	}
+}
+
+bool EpollEventDispatcher::activateSocketNotifiers(int fd, quint32 events)
+{
+	// Errors and hangups are reported to the read and write notifiers, like poll() does
+	QList<QSocketNotifier::Type> types;
+	if(events & (EPOLLIN | EPOLLHUP | EPOLLERR)) types.append(QSocketNotifier::Read);
+	if(events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) types.append(QSocketNotifier::Write);
+	if(events & EPOLLPRI) types.append(QSocketNotifier::Exception);
+
+	bool processed = false;
+	for(const auto &type : types) {
+		// Look the notifier up again, since activating the previous one can unregister or delete it
+		auto it = socketNotifiers.constFind(fd);
+		if(it == socketNotifiers.constEnd()) {
+			break;
+		}
+
+		QSocketNotifier *notifier = type == QSocketNotifier::Read
+			? it->read
+			: type == QSocketNotifier::Write ? it->write : it->exception;
+		if(notifier) {
+			QEvent event(QEvent::SockAct);
+			QCoreApplication::sendEvent(notifier, &event);
+			processed = true;
+		}
+	}
+
+	return processed;
+}
+
+void EpollEventDispatcher::registerTimer(int timerId, int interval, Qt::TimerType timerType, QObject *object)
+{
+	timers.insert(timerId, {interval, timerType, object, clock.elapsed() + interval});
+}
+
+bool EpollEventDispatcher::unregisterTimer(int timerId)
+{
+	return timers.remove(timerId) > 0;
+}
+
+bool EpollEventDispatcher::unregisterTimers(QObject *object)
+{
+	bool removed = false;
+	for(auto it = timers.begin(); it != timers.end();) {
+		if(it->object == object) {
+			it = timers.erase(it);
+			removed = true;
+		}
+		else {
+			it++;
+		}
+	}
+
+	return removed;
+}
+
+QList<QAbstractEventDispatcher::TimerInfo> EpollEventDispatcher::registeredTimers(QObject *object) const
+{
+	QList<TimerInfo> timerInfos;
+	for(auto it = timers.constBegin(); it != timers.constEnd(); it++) {
+		if(it->object == object) {
+			timerInfos.append(TimerInfo(it.key(), it->interval, it->timerType));
+		}
+	}
+
+	return timerInfos;
+}
+
+int EpollEventDispatcher::remainingTime(int timerId)
+{
+	auto it = timers.constFind(timerId);
+	if(it == timers.constEnd()) {
+		return -1;
+	}
+
+	return int(qMax(qint64(0), it->deadline - clock.elapsed()));
+}
+
+int EpollEventDispatcher::getTimeout() const
+{
+	// Wait until the first timer expires, there are few timers compared to sockets so a scan is cheap enough
+	if(timers.isEmpty()) {
+		return -1;
+	}
+
+	qint64 deadline = std::numeric_limits<qint64>::max();
+	for(const auto &timer : timers) {
+		deadline = qMin(deadline, timer.deadline);
+	}
+
+	return int(qBound(qint64(0), deadline - clock.elapsed(), qint64(std::numeric_limits<int>::max())));
+}
+
+bool EpollEventDispatcher::activateTimers()
+{
+	qint64 now = clock.elapsed();
+	QList<int> expired;
+	for(auto it = timers.begin(); it != timers.end(); it++) {
+		if(it->deadline <= now) {
+			// Schedule the next timeout before activating, so a nested event loop doesn't activate it again
+			it->deadline = it->timerType == Qt::PreciseTimer
+				? qMax(it->deadline + it->interval, now)
+				: now + it->interval;
+			expired.append(it.key());
+		}
+	}
+
+	for(const auto &timerId : expired) {
+		// Activating a timer can unregister the others
+		auto it = timers.constFind(timerId);
+		if(it != timers.constEnd()) {
+			QTimerEvent event(timerId);
+			QCoreApplication::sendEvent(it->object, &event);
+		}
+	}
+
+	return !expired.isEmpty();
+}
+
+void EpollEventDispatcher::wakeUp()
+{
+	// Only the first wake up since the last iteration has to write, the event file descriptor stays readable
+	if(wokenUp.testAndSetAcquire(0, 1)) {
+		eventfd_write(wakeUpFd, 1);
+	}
+}
+
+void EpollEventDispatcher::interrupt()
+{
+	interrupted.storeRelease(1);
+	wakeUp();
+}
+
+void EpollEventDispatcher::flush()
+{
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef EPOLLEVENTDISPATCHER_H
+#define EPOLLEVENTDISPATCHER_H
+
+#include <QAbstractEventDispatcher>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QAtomicInt>
+
+// Dispatches the events of a thread using epoll, so the cost of waiting doesn't grow with the amount of sockets like
+// the poll() of Qt's default dispatcher. Only for Linux, set it before creating the application.
+class EpollEventDispatcher : public QAbstractEventDispatcher
+{
+	Q_OBJECT
+
+	private:
+		// The socket notifiers of a single file descriptor, epoll only allows to register it once
+		struct SocketNotifiers
+		{
+			QSocketNotifier *read = nullptr;
+			QSocketNotifier *write = nullptr;
+			QSocketNotifier *exception = nullptr;
+		};
+
+		struct Timer
+		{
+			int interval;
+			Qt::TimerType timerType;
+			QObject *object;
+			qint64 deadline;
+		};
+
+		int epollFd;
+		int wakeUpFd;
+		QAtomicInt wokenUp;
+		QAtomicInt interrupted;
+
+		QHash<int, SocketNotifiers> socketNotifiers;
+		QHash<int, Timer> timers;
+		QElapsedTimer clock;
+
+		void updateSocketNotifiers(int fd, bool added);
+		int getTimeout() const;
+		bool activateSocketNotifiers(int fd, quint32 events);
+		bool activateTimers();
+
+	public:
+		explicit EpollEventDispatcher(QObject *parent = nullptr);
+		~EpollEventDispatcher();
+
+		bool processEvents(QEventLoop::ProcessEventsFlags flags) override;
+		bool hasPendingEvents() override;
+
+		void registerSocketNotifier(QSocketNotifier *notifier) override;
+		void unregisterSocketNotifier(QSocketNotifier *notifier) override;
+
+		void registerTimer(int timerId, int interval, Qt::TimerType timerType, QObject *object) override;
+		bool unregisterTimer(int timerId) override;
+		bool unregisterTimers(QObject *object) override;
+		QList<TimerInfo> registeredTimers(QObject *object) const override;
+		int remainingTime(int timerId) override;
+
+		void wakeUp() override;
+		void interrupt() override;
+		void flush() override;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "federation.h"
+#include <QTimer>
+
+// The time in ms before reconnecting to a federated server, doubling up to the maximum on every failed attempt
+static const int RetryInterval = 1000;
+static const int MaxRetryInterval = 60 * 1000;
+
+Federation::Federation(ServiceRepository &serviceRepository, const QList<QString> &urls, const QString &origin, int pingInterval, bool verbose) :
+	QObject(),
+	serviceRepository(serviceRepository),
+	verbose(verbose),
+	merging(false)
+{
+	// Observe the repository, to notice services discovered locally
+	serviceRepository.setOrigin(origin);
+	serviceRepository.addObserver(this);
+
+	// Follow every federated server like a client would, only the changes are sent after the first connection
+	for(const auto &url : urls) {
+		std::unique_ptr<Link> link(new Link());
+		link->federation = this;
+		link->repository.addObserver(link.get());
+		link->clientSocket.reset(new ClientSocket(link->repository, nullptr, url, -1, RetryInterval, MaxRetryInterval, -1, pingInterval, true, false, verbose));
+		links.push_back(std::move(link));
+	}
+
+	if(verbose) qDebug() << "Federating" << urls.size() << "servers as" << origin;
+}
+
+Federation::~Federation()
+{
+	// Close the connections before their repositories are destroyed
+	for(auto &link : links) {
+		link->clientSocket.reset();
+	}
+}
+
+void Federation::Link::onAddOrUpdateService(const QMdnsEngine::Service &service)
+{
+	federation->onLinkAddOrUpdateService(this, repository.getServiceFullName(service));
+}
+
+void Federation::Link::onRemoveService(const QString &fullName)
+{
+	federation->onLinkRemoveService(this, fullName.toUtf8());
+}
+
+bool Federation::isLooped(Link *link, const QByteArray &fullName) const
+{
+	// The service passed through this server before, it is either announced here already or it disappeared
+	return link->repository.getPaths().value(fullName).contains(serviceRepository.getOrigin());
+}
+
+void Federation::onLinkAddOrUpdateService(Link *link, const QByteArray &fullName)
+{
+	if(isLooped(link, fullName)) {
+		onLinkRemoveService(link, fullName);
+		return;
+	}
+
+	// Keep services discovered locally and services already merged from another server
+	bool exists = serviceRepository.getServices().contains(fullName);
+	if(exists && owners.value(fullName) != link) {
+		return;
+	}
+
+	mergeService(link, fullName);
+}
+
+void Federation::onLinkRemoveService(Link *link, const QByteArray &fullName)
+{
+	// Only remove the service if it came from this server, then look for it on the others
+	if(owners.value(fullName) == link) {
+		removeService(fullName);
+		adoptService(fullName);
+	}
+}
+
+void Federation::mergeService(Link *link, const QByteArray &fullName)
+{
+	merging = true;
+
+	serviceRepository.getServices()[fullName] = link->repository.getServices().value(fullName);
+	serviceRepository.getAddresses()[fullName] = link->repository.getAddresses().value(fullName);
+	serviceRepository.getPaths()[fullName] = link->repository.getPaths().value(fullName);
+	owners[fullName] = link;
+
+	serviceRepository.notifyAddOrUpdateService(serviceRepository.getServices()[fullName]);
+
+	merging = false;
+}
+
+void Federation::removeService(const QByteArray &fullName)
+{
+	merging = true;
+
+	serviceRepository.getServices().remove(fullName);
+	serviceRepository.getAddresses().remove(fullName);
+	serviceRepository.getPaths().remove(fullName);
+	owners.remove(fullName);
+
+	serviceRepository.notifyRemoveService(fullName);
+
+	merging = false;
+}
+
+void Federation::adoptService(const QByteArray &fullName)
+{
+	if(serviceRepository.getServices().contains(fullName)) {
+		return;
+	}
+
+	// Take the service from the first federated server that still announces it
+	for(auto &link : links) {
+		if(link->repository.getServices().contains(fullName) && !isLooped(link.get(), fullName)) {
+			mergeService(link.get(), fullName);
+			return;
+		}
+	}
+}
+
+void Federation::onAddOrUpdateService(const QMdnsEngine::Service &service)
+{
+	// A service discovered locally replaced a merged one
+	if(!merging) {
+		owners.remove(serviceRepository.getServiceFullName(service));
+	}
+}
+
+void Federation::onRemoveService(const QString &fullName)
+{
+	// A service discovered locally disappeared, a federated server may still announce it. Wait until the other
+	// observers handled the removal, so they don't see the service again before it was removed.
+	if(!merging) {
+		QByteArray name = fullName.toUtf8();
+		QTimer::singleShot(0, this, [this, name]() {
+			adoptService(name);
+		});
+	}
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef FEDERATION_H
+#define FEDERATION_H
+
+#include <memory>
+#include <vector>
+#include "../common/servicerepository.h"
+#include "../common/clientsocket.h"
+
+// Merges the services of other servers into the repository, so one server can serve the services of several subnets.
+// Every federated server is followed by a client socket with a repository of its own, the services discovered locally
+// take precedence over the ones of federated servers.
+class Federation : public QObject, public Observer
+{
+	Q_OBJECT
+
+	private:
+		// The connection to a federated server and the services it announced
+		struct Link : public Observer
+		{
+			Federation *federation;
+			ServiceRepository repository;
+			std::unique_ptr<ClientSocket> clientSocket;
+
+			void onAddOrUpdateService(const QMdnsEngine::Service &service) override;
+			void onRemoveService(const QString &fullName) override;
+		};
+
+		ServiceRepository &serviceRepository;
+		bool verbose;
+
+		std::vector<std::unique_ptr<Link>> links;
+
+		// The link each merged service came from, services discovered locally have none
+		QMap<QByteArray, Link *> owners;
+		bool merging;
+
+		void onLinkAddOrUpdateService(Link *link, const QByteArray &fullName);
+		void onLinkRemoveService(Link *link, const QByteArray &fullName);
+		bool isLooped(Link *link, const QByteArray &fullName) const;
+		void mergeService(Link *link, const QByteArray &fullName);
+		void removeService(const QByteArray &fullName);
+		void adoptService(const QByteArray &fullName);
+
+	public:
+		// Origin: identifies this server, services that already passed through it are ignored to prevent loops
+		Federation(ServiceRepository &serviceRepository, const QList<QString> &urls, const QString &origin, int pingInterval, bool verbose);
+		~Federation();
+
+		void onAddOrUpdateService(const QMdnsEngine::Service &service) override;
+		void onRemoveService(const QString &fullName) override;
+};
+
+#endif
\ No newline at end of file
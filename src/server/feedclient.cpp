@@ -0,0 +1,108 @@
+#include "feedclient.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include "../common/messagetype.h"
+
+// The time in ms between attempts to reach the leader
+static const int ReconnectInterval = 1000;
+
+FeedClient::FeedClient(ServiceRepository &serviceRepository, const QString &name, bool verbose) :
+	QObject(),
+	serviceRepository(serviceRepository),
+	name(name),
+	verbose(verbose),
+	localSocket(this),
+	reconnectTimer(this)
+{
+	// Register event handlers
+	connect(&localSocket, &QLocalSocket::connected, this, &FeedClient::onConnected);
+	connect(&localSocket, &QLocalSocket::disconnected, this, &FeedClient::onDisconnected);
+	connect(&localSocket, &QLocalSocket::readyRead, this, &FeedClient::onReadyRead);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+	connect(&localSocket, &QLocalSocket::errorOccurred, this, &FeedClient::onDisconnected);
+#else
+	connect(&localSocket, QOverload<QLocalSocket::LocalSocketError>::of(&QLocalSocket::error), this, &FeedClient::onDisconnected);
+#endif
+	connect(&reconnectTimer, &QTimer::timeout, this, &FeedClient::onReconnect);
+
+	// Keep serving the last known services while the leader is unreachable
+	reconnectTimer.setSingleShot(true);
+	reconnectTimer.setInterval(ReconnectInterval);
+
+	localSocket.connectToServer(name);
+}
+
+FeedClient::~FeedClient()
+{
+	localSocket.abort();
+}
+
+void FeedClient::onConnected()
+{
+	if(verbose) qDebug() << "Following feed on" << localSocket.fullServerName();
+}
+
+void FeedClient::onDisconnected()
+{
+	// Both the error and the disconnection are reported for a lost connection
+	if(reconnectTimer.isActive()) {
+		return;
+	}
+
+	if(verbose) qDebug() << "Feed unreachable, retrying ...";
+	reconnectTimer.start();
+}
+
+void FeedClient::onReconnect()
+{
+	localSocket.abort();
+	localSocket.connectToServer(name);
+}
+
+void FeedClient::onReadyRead()
+{
+	while(localSocket.canReadLine()) {
+		processMessage(localSocket.readLine());
+	}
+}
+
+void FeedClient::processMessage(const QByteArray &message)
+{
+	QJsonDocument jsonDocument = QJsonDocument::fromJson(message);
+	QJsonObject jsonMessage = jsonDocument.object();
+
+	switch(jsonMessage["type"].toInt()) {
+		case MessageType::ALL: {
+			// Only apply the differences with the current services, for example after the leader restarted
+			serviceRepository.applySnapshot(jsonMessage["services"].toArray());
+			break;
+		}
+		case MessageType::ADD_OR_UPDATE: {
+			serviceRepository.addOrUpdateIfChanged(jsonMessage["service"].toObject());
+			break;
+		}
+		case MessageType::REMOVE: {
+			serviceRepository.removeIfExists(jsonMessage["fullname"].toString().toUtf8());
+			break;
+		}
+		default: {
+			if(verbose) qDebug() << "Unsupported feed message type" << jsonMessage["type"].toInt();
+			return;
+		}
+	}
+
+	setRevision(jsonMessage);
+}
+
+void FeedClient::setRevision(const QJsonObject &jsonMessage)
+{
+	// Applying the leader's changes counts the same revisions, unless this process missed some of them
+	QByteArray epoch = jsonMessage.contains("epoch") ? jsonMessage["epoch"].toString().toUtf8() : serviceRepository.getEpoch();
+	quint64 revision = quint64(jsonMessage["revision"].toDouble());
+	if(epoch != serviceRepository.getEpoch() || revision != serviceRepository.getRevision()) {
+		serviceRepository.setEpoch(epoch);
+		serviceRepository.setRevision(revision);
+		serviceRepository.notifyResetRevision();
+	}
+}
\ No newline at end of file
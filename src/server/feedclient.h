@@ -0,0 +1,37 @@
+#ifndef FEEDCLIENT_H
+#define FEEDCLIENT_H
+
+#include <QLocalSocket>
+#include <QTimer>
+#include "../common/servicerepository.h"
+
+// Follows the feed of the leading server process, keeping the repository identical to the leader's instead of
+// discovering the services
+class FeedClient : public QObject
+{
+	Q_OBJECT
+
+	private:
+		ServiceRepository &serviceRepository;
+		QString name;
+		bool verbose;
+
+		QLocalSocket localSocket;
+		QTimer reconnectTimer;
+
+		void processMessage(const QByteArray &message);
+		void setRevision(const QJsonObject &jsonMessage);
+
+	public:
+		// Name: the name of the local socket the leader publishes its feed on
+		FeedClient(ServiceRepository &serviceRepository, const QString &name, bool verbose);
+		~FeedClient();
+
+	private slots:
+		void onConnected();
+		void onDisconnected();
+		void onReconnect();
+		void onReadyRead();
+};
+
+#endif
\ No newline at end of file
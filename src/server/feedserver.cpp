@@ -0,0 +1,99 @@
+#include "feedserver.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "../common/messagetype.h"
+
+FeedServer::FeedServer(ServiceRepository &serviceRepository, const QString &name, bool verbose) :
+	QObject(),
+	serviceRepository(serviceRepository),
+	verbose(verbose)
+{
+	// Observe the repository
+	serviceRepository.addObserver(this);
+
+	// Register event handlers
+	connect(&localServer, &QLocalServer::newConnection, this, &FeedServer::onFollowerConnected);
+
+	// Remove the socket a previous leader left behind when it crashed
+	QLocalServer::removeServer(name);
+	if(localServer.listen(name)) {
+		if(verbose) qDebug() << "Publishing feed on" << localServer.fullServerName();
+	}
+	else {
+		qWarning() << "Failed to publish feed on" << name << ":" << localServer.errorString();
+	}
+}
+
+FeedServer::~FeedServer()
+{
+	// Stop listening for incoming connections
+	localServer.close();
+}
+
+void FeedServer::onFollowerConnected()
+{
+	QLocalSocket *follower = localServer.nextPendingConnection();
+
+	if(verbose) qDebug() << "Follower connected";
+
+	// Register event handlers
+	connect(follower, &QLocalSocket::disconnected, this, &FeedServer::onFollowerDisconnected);
+
+	followers.append(follower);
+
+	// Send all services, followers take over the epoch and revision so their clients can switch processes
+	QByteArray json = "{\"type\":" + QByteArray::number(MessageType::ALL) + ",\"revision\":" + QByteArray::number(serviceRepository.getRevision()) + ",\"epoch\":\"" + serviceRepository.getEpoch() + "\",\"services\":[";
+	const QMap<QByteArray, QMdnsEngine::Service> &services = serviceRepository.getServices();
+	for(auto it = services.constBegin(); it != services.constEnd(); it++) {
+		if(it != services.constBegin()) {
+			json += ',';
+		}
+		json += serviceRepository.getJsonService(*it);
+	}
+	json += "]}";
+
+	sendMessage(follower, json);
+}
+
+void FeedServer::onFollowerDisconnected()
+{
+	QLocalSocket *follower = qobject_cast<QLocalSocket *>(sender());
+
+	if(verbose) qDebug() << "Follower disconnected";
+
+	if(follower) {
+		followers.removeAll(follower);
+		follower->deleteLater();
+	}
+}
+
+void FeedServer::onAddOrUpdateService(const QMdnsEngine::Service &service)
+{
+	QByteArray json = "{\"type\":" + QByteArray::number(MessageType::ADD_OR_UPDATE) + ",\"revision\":" + QByteArray::number(serviceRepository.getRevision()) + ",\"service\":" + serviceRepository.getJsonService(service) + "}";
+	broadcastMessage(json);
+}
+
+void FeedServer::onRemoveService(const QString &fullName)
+{
+	QJsonObject jsonMessage;
+	jsonMessage["type"] = MessageType::REMOVE;
+	jsonMessage["revision"] = double(serviceRepository.getRevision());
+	jsonMessage["fullname"] = fullName;
+
+	QJsonDocument jsonDocument(jsonMessage);
+	broadcastMessage(jsonDocument.toJson(QJsonDocument::Compact));
+}
+
+void FeedServer::broadcastMessage(const QByteArray &message)
+{
+	for(const auto &follower : followers) {
+		sendMessage(follower, message);
+	}
+}
+
+void FeedServer::sendMessage(QLocalSocket *follower, const QByteArray &message)
+{
+	// Compact JSON never contains a newline, so it separates the messages
+	follower->write(message);
+	follower->write("\n");
+}
\ No newline at end of file
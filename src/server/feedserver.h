@@ -0,0 +1,38 @@
+#ifndef FEEDSERVER_H
+#define FEEDSERVER_H
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include "../common/servicerepository.h"
+
+// Publishes the changes of the repository over a Unix domain socket, so other server processes sharing the port
+// don't need to discover the services themselves. Followers first get all services, then every change as one line
+// of JSON using the same messages as the websocket clients.
+class FeedServer : public QObject, public Observer
+{
+	Q_OBJECT
+
+	private:
+		ServiceRepository &serviceRepository;
+		bool verbose;
+
+		QLocalServer localServer;
+		QList<QLocalSocket *> followers;
+
+		void sendMessage(QLocalSocket *follower, const QByteArray &message);
+		void broadcastMessage(const QByteArray &message);
+
+	public:
+		// Name: the name of the local socket, or an absolute path
+		FeedServer(ServiceRepository &serviceRepository, const QString &name, bool verbose);
+		~FeedServer();
+
+		void onAddOrUpdateService(const QMdnsEngine::Service &service) override;
+		void onRemoveService(const QString &fullName) override;
+
+	private slots:
+		void onFollowerConnected();
+		void onFollowerDisconnected();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "httpserver.h"
+#include <QTimer>
+
+// Requests with larger headers are rejected
+static const int MaxHeaderSize = 8192;
+
+// Connections that don't send a request or read the response within this time are aborted (ms)
+static const int ConnectionTimeout = 5000;
+
+static QByteArray statusText(int status)
+{
+	switch(status) {
+		case 200: return "OK";
+		case 304: return "Not Modified";
+		case 400: return "Bad Request";
+		case 404: return "Not Found";
+		case 405: return "Method Not Allowed";
+		default: return "Internal Server Error";
+	}
+}
+
+HttpServer::HttpServer(const QString &address, int port, bool verbose) :
+	QObject(),
+	verbose(verbose)
+{
+	// Register event handlers
+	connect(&tcpServer, &QTcpServer::newConnection, this, &HttpServer::onClientConnected);
+
+	// Start listening for incoming connections, a negative port disables the server
+	if(port >= 0 && tcpServer.listen(QHostAddress(address), port)) {
+		if(verbose) qDebug() << "HTTP listening on address" << address << "and port" << port;
+	}
+}
+
+HttpServer::~HttpServer()
+{
+	// Stop listening for incoming connections
+	tcpServer.close();
+}
+
+void HttpServer::addRoute(const QString &path, const Handler &handler)
+{
+	routes[path] = handler;
+}
+
+void HttpServer::onClientConnected()
+{
+	while(tcpServer.hasPendingConnections()) {
+		QTcpSocket *socket = tcpServer.nextPendingConnection();
+
+		// Register event handlers
+		connect(socket, &QTcpSocket::readyRead, this, &HttpServer::onReadyRead);
+		connect(socket, &QTcpSocket::disconnected, this, &HttpServer::onClientDisconnected);
+
+		// Abort idle connections, so clients can't hold on to them by sending nothing or a partial request
+		QTimer *timer = new QTimer(socket);
+		timer->setObjectName("timeout");
+		timer->setSingleShot(true);
+		connect(timer, &QTimer::timeout, socket, &QTcpSocket::abort);
+		timer->start(ConnectionTimeout);
+
+		buffers[socket] = QByteArray();
+	}
+}
+
+void HttpServer::onReadyRead()
+{
+	QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+	if(!socket || !buffers.contains(socket)) {
+		return;
+	}
+
+	// Wait until the complete request head has been received, request bodies are ignored
+	QByteArray &buffer = buffers[socket];
+	buffer += socket->readAll();
+	int end = buffer.indexOf("\r\n\r\n");
+	if(end < 0) {
+		if(buffer.size() > MaxHeaderSize) {
+			HttpResponse response;
+			response.status = 400;
+			sendResponse(socket, response);
+		}
+		return;
+	}
+
+	QByteArray head = buffer.left(end);
+	buffers.remove(socket);
+	handleRequest(socket, head);
+}
+
+void HttpServer::onClientDisconnected()
+{
+	// Forget the connection and deallocate memory
+	QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+	if(socket) {
+		buffers.remove(socket);
+		socket->deleteLater();
+	}
+}
+
+void HttpServer::handleRequest(QTcpSocket *socket, const QByteArray &head)
+{
+	// Parse the request line and the headers
+	QList<QByteArray> lines = head.split('\n');
+	QList<QByteArray> requestLine = lines.takeFirst().trimmed().split(' ');
+	if(requestLine.size() != 3) {
+		HttpResponse response;
+		response.status = 400;
+		sendResponse(socket, response);
+		return;
+	}
+
+	HttpRequest request;
+	request.method = requestLine[0];
+	request.url = QUrl::fromEncoded(requestLine[1]);
+	for(const auto &line : lines) {
+		int colon = line.indexOf(':');
+		if(colon > 0) {
+			request.headers[line.left(colon).trimmed().toLower()] = line.mid(colon + 1).trimmed();
+		}
+	}
+
+	if(verbose) qDebug() << "HTTP" << request.method << request.url.toString();
+
+	// Find the handler for the path
+	HttpResponse response;
+	auto route = routes.find(request.url.path());
+	if(route == routes.end()) {
+		response.status = 404;
+	} else if(request.method != "GET" && request.method != "HEAD") {
+		response.status = 405;
+	} else {
+		response = (*route)(request);
+		if(request.method == "HEAD") {
+			response.headers["Content-Length"] = QByteArray::number(response.body.size());
+			response.body.clear();
+		}
+	}
+
+	sendResponse(socket, response);
+}
+
+void HttpServer::sendResponse(QTcpSocket *socket, const HttpResponse &response)
+{
+	QByteArray output = "HTTP/1.1 " + QByteArray::number(response.status) + " " + statusText(response.status) + "\r\n";
+	output += "Content-Type: " + response.contentType + "\r\n";
+	if(!response.headers.contains("Content-Length")) {
+		output += "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n";
+	}
+	for(auto it = response.headers.begin(); it != response.headers.end(); it++) {
+		output += it.key() + ": " + it.value() + "\r\n";
+	}
+	output += "Connection: close\r\n\r\n";
+	output += response.body;
+
+	// Close the connection once everything has been written, giving the client a new timeout to read the response
+	buffers.remove(socket);
+	socket->write(output);
+	socket->disconnectFromHost();
+	QTimer *timer = socket->findChild<QTimer *>("timeout", Qt::FindDirectChildrenOnly);
+	if(timer) {
+		timer->start(ConnectionTimeout);
+	}
+}
@@ -0,0 +1,55 @@
+#ifndef HTTPSERVER_H
+#define HTTPSERVER_H
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUrl>
+#include <QMap>
+#include <functional>
+
+struct HttpRequest
+{
+	QByteArray method;
+	QUrl url;
+	QMap<QByteArray, QByteArray> headers;
+};
+
+struct HttpResponse
+{
+	int status = 200;
+	QByteArray contentType = "text/plain";
+	QByteArray body;
+	QMap<QByteArray, QByteArray> headers;
+};
+
+// Minimal HTTP/1.1 server answering one request per connection
+class HttpServer : public QObject
+{
+	Q_OBJECT
+
+	public:
+		typedef std::function<HttpResponse(const HttpRequest &)> Handler;
+
+	private:
+		bool verbose;
+
+		QTcpServer tcpServer;
+		QMap<QString, Handler> routes;
+		QMap<QTcpSocket *, QByteArray> buffers;
+
+		void handleRequest(QTcpSocket *socket, const QByteArray &head);
+		void sendResponse(QTcpSocket *socket, const HttpResponse &response);
+
+	public:
+		HttpServer(const QString &address, int port, bool verbose);
+		~HttpServer();
+
+		void addRoute(const QString &path, const Handler &handler);
+
+	private slots:
+		void onClientConnected();
+		void onReadyRead();
+		void onClientDisconnected();
+};
+
+#endif
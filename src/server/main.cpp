@@ -1,11 +1,40 @@
 #include <QCoreApplication>
 #include <QCommandLineParser>
+#include <QSysInfo>
+#include <cstring>
+#include <memory>
+#ifdef QMDNSENGINE_TRACING
+#include <QBuffer>
+#include <QSaveFile>
+#include <QTimer>
+#include <qmdnsengine/trace.h>
+#endif
 #include "../common/servicerepository.h"
+#include "../common/signalhandler.h"
 #include "servicediscovery.h"
 #include "serversocket.h"
+#include "metrics.h"
+#include "httpserver.h"
+#include "feedserver.h"
+#include "feedclient.h"
+#include "federation.h"
+#include "servicequery.h"
+#ifdef HAVE_EPOLL
+#include "epolleventdispatcher.h"
+#endif
 
 int main(int argc, char *argv[])
 {
+#ifdef HAVE_EPOLL
+	// The event dispatcher of the main thread has to be set before creating the application
+	for(int i = 1; i < argc; i++) {
+		if(std::strcmp(argv[i], "--epoll") == 0) {
+			QCoreApplication::setEventDispatcher(new EpollEventDispatcher());
+			break;
+		}
+	}
+#endif
+
 	QCoreApplication app(argc, argv);
 	app.setApplicationName("Server");
 	app.setApplicationVersion("1.0.0");
@@ -17,26 +46,150 @@ int main(int argc, char *argv[])
 	parser.setApplicationDescription("Bonjour/Zeroconf multicast DNS websocket server.");
 	parser.addHelpOption();
 	parser.addVersionOption();
-	parser.addOption({{"t", "type"}, "The service type to browse for (default = any = _services._dns-sd._udp.local.).", "type", "_services._dns-sd._udp.local."});
+	parser.addOption({{"t", "type"}, "The service type to browse for, can be repeated to browse for several types at a lower cost than browsing for any type (default = any = _services._dns-sd._udp.local.).", "type", "_services._dns-sd._udp.local."});
 	parser.addOption({{"n", "name"}, "The name to identify the server during the HTTP handshake (default = \"\").", "name", ""});
 	parser.addOption({{"a", "address"}, "The address to listen to for incoming connections (default = any = 0.0.0.0).", "address", "0.0.0.0"});
 	parser.addOption({{"p", "port"}, "The port to listen to for incoming connections (default = 1234).", "port", "1234"});
 	parser.addOption({{"c", "no-cache"}, "Disable the use of a cache for DNS records."});
+	parser.addOption({"cache-file", "The file to store the cache for DNS records in, restoring it on startup (default = none).", "file", ""});
+	parser.addOption({"cache-max-entries", "The maximum amount of DNS records in the cache (default = unlimited = -1).", "max", "-1"});
+	parser.addOption({"cache-max-size", "The maximum approximate size in bytes of the DNS records in the cache (default = unlimited = -1).", "bytes", "-1"});
+	parser.addOption({"cache-max-source-entries", "The maximum amount of DNS records in the cache from a single host (default = unlimited = -1).", "max", "-1"});
+	parser.addOption({"cache-stats-interval", "The time in ms between printing statistics of the cache (default = never = -1).", "interval", "-1"});
+	parser.addOption({"max-accept-rate", "The maximum amount of connections accepted per second (default = unlimited = -1).", "rate", "-1"});
+	parser.addOption({"max-snapshot-rate", "The maximum amount of snapshots of all services sent per second, queueing other clients (default = unlimited = -1).", "rate", "-1"});
+	parser.addOption({"ping-interval", "The time in ms between pinging clients and sending them the current revision, disconnecting clients that stop responding (default = 30000, never = -1).", "interval", "30000"});
+#ifdef HAVE_REUSEPORT
+	parser.addOption({"reuse-port", "Share the port with other server processes using SO_REUSEPORT, the kernel balances the connections between them."});
+#endif
+	parser.addOption({"publish-feed", "Discover the services and publish the changes to following server processes on this local socket (default = none).", "name", ""});
+	parser.addOption({"follow-feed", "Don't discover the services, but follow the changes published by the leading server process on this local socket (default = none).", "name", ""});
+	parser.addOption({"federate", "Merge the services of another server into the ones of this server, can be repeated (default = none).", "url"});
+	parser.addOption({"federation-id", "The name identifying this server to federated servers, which must be unique among them (default = hostname:port).", "id", ""});
+	parser.addOption({"indented-json", "Send indented instead of compact JSON messages, for debugging."});
+#ifdef QMDNSENGINE_TRACING
+	parser.addOption({{"http-port", "metrics-port"}, "The port to serve HTTP on, with Prometheus metrics at /metrics, tracing spans at /trace and service lookups at /services (default = disabled = -1).", "port", "-1"});
+	parser.addOption({"trace-file", "The file to periodically write recorded tracing spans to (default = none).", "file", ""});
+#else
+	parser.addOption({{"http-port", "metrics-port"}, "The port to serve HTTP on, with Prometheus metrics at /metrics and service lookups at /services (default = disabled = -1).", "port", "-1"});
+#endif
+#ifdef HAVE_EPOLL
+	parser.addOption({"epoll", "Wait for events using epoll instead of poll, which scales better with thousands of connections."});
+#endif
 	parser.addOption({"verbose", "Displays debug information."});
 	parser.process(app);
 
 	// Parse command line options
-	QString type = parser.value("t");
+	QList<QString> types = parser.values("t");
 	QString name = parser.value("n");
 	QString address = parser.value("a");
 	int port = parser.value("p").toInt();
 	bool noCache = parser.isSet("c");
+	QString cacheFile = parser.value("cache-file");
+	int cacheMaxEntries = parser.value("cache-max-entries").toInt();
+	qint64 cacheMaxSize = parser.value("cache-max-size").toLongLong();
+	int cacheMaxSourceEntries = parser.value("cache-max-source-entries").toInt();
+	int cacheStatsInterval = parser.value("cache-stats-interval").toInt();
+	int maxAcceptRate = parser.value("max-accept-rate").toInt();
+	int maxSnapshotRate = parser.value("max-snapshot-rate").toInt();
+	int pingInterval = parser.value("ping-interval").toInt();
+	bool reusePort = false;
+#ifdef HAVE_REUSEPORT
+	reusePort = parser.isSet("reuse-port");
+#endif
+	QString publishFeed = parser.value("publish-feed");
+	QString followFeed = parser.value("follow-feed");
+	QList<QString> federate = parser.values("federate");
+	QString federationId = parser.value("federation-id");
+	bool indentedJson = parser.isSet("indented-json");
+	int httpPort = parser.value("http-port").toInt();
+#ifdef QMDNSENGINE_TRACING
+	QString traceFile = parser.value("trace-file");
+#endif
 	bool verbose = parser.isSet("verbose");
 
+	// Quit on SIGINT and SIGTERM, so the cache of DNS records is stored one last time
+	SignalHandler signalHandler;
+
 	// Create components
 	ServiceRepository serviceRepository;
-	ServiceDiscovery servicediscovery(serviceRepository, type, noCache);
-	ServerSocket serverSocket(serviceRepository, name, address, port, verbose);
+	Metrics metrics;
+	ServerSocket serverSocket(serviceRepository, metrics, name, address, port, maxAcceptRate, maxSnapshotRate, pingInterval, reusePort, indentedJson, verbose);
+
+	// Only the leading process runs the multicast DNS stack, the followers get the services from it
+	std::unique_ptr<ServiceDiscovery> servicediscovery;
+	std::unique_ptr<FeedServer> feedServer;
+	std::unique_ptr<FeedClient> feedClient;
+	if(followFeed.isEmpty()) {
+		if(!publishFeed.isEmpty()) {
+			feedServer.reset(new FeedServer(serviceRepository, publishFeed, verbose));
+		}
+		servicediscovery.reset(new ServiceDiscovery(serviceRepository, metrics, types, noCache, cacheFile, cacheMaxEntries, cacheMaxSize, cacheMaxSourceEntries, cacheStatsInterval));
+	}
+	else {
+		feedClient.reset(new FeedClient(serviceRepository, followFeed, verbose));
+	}
+
+	// Serve the services of other subnets too, only the leading process follows the federated servers
+	std::unique_ptr<Federation> federation;
+	if(!federate.isEmpty() && followFeed.isEmpty()) {
+		if(federationId.isEmpty()) {
+			federationId = QSysInfo::machineHostName() + ":" + QString::number(port);
+		}
+		federation.reset(new Federation(serviceRepository, federate, federationId, pingInterval, verbose));
+	}
+
+	ServiceQuery serviceQuery(serviceRepository);
+	HttpServer httpServer(address, httpPort, verbose);
+
+	// Expose the metrics over HTTP
+	httpServer.addRoute("/metrics", [&metrics](const HttpRequest &) {
+		HttpResponse response;
+		response.contentType = "text/plain; version=0.0.4";
+		response.body = metrics.toPrometheus();
+		return response;
+	});
+
+#ifdef QMDNSENGINE_TRACING
+	// Expose the recorded tracing spans over HTTP
+	httpServer.addRoute("/trace", [](const HttpRequest &) {
+		HttpResponse response;
+		response.contentType = "application/json";
+		QBuffer buffer(&response.body);
+		buffer.open(QIODevice::WriteOnly);
+		QMdnsEngine::writeChromeTrace(&buffer);
+		return response;
+	});
+#endif
+
+	// Answer lookups of services over HTTP
+	httpServer.addRoute("/services", [&serviceQuery](const HttpRequest &request) {
+		return serviceQuery.handleRequest(request);
+	});
+
+#ifdef QMDNSENGINE_TRACING
+	// Periodically write the recorded tracing spans, so they survive a crash
+	auto writeTrace = [&traceFile]() {
+		QSaveFile file(traceFile);
+		if(file.open(QIODevice::WriteOnly) && QMdnsEngine::writeChromeTrace(&file)) {
+			file.commit();
+		}
+	};
+	QTimer traceTimer;
+	QObject::connect(&traceTimer, &QTimer::timeout, writeTrace);
+	if(!traceFile.isEmpty()) {
+		traceTimer.start(10 * 1000);
+	}
+#endif
+
+	int result = app.exec();
+
+#ifdef QMDNSENGINE_TRACING
+	// Write the recorded tracing spans one last time, the signal handler quits the event loop on SIGINT and SIGTERM
+	if(!traceFile.isEmpty()) {
+		writeTrace();
+	}
+#endif
 
-	return app.exec();
+	return result;
 }
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "metrics.h"
+
+// Duration buckets in seconds, from 100 µs up to 1 s
+static const QVector<double> DurationBounds = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1};
+
+Histogram::Histogram(const QVector<double> &bounds) :
+	bounds(bounds),
+	counts(bounds.size() + 1, 0),
+	sum(0),
+	count(0)
+{
+}
+
+void Histogram::observe(double value)
+{
+	// The last count is for values above the highest bound
+	int bucket = 0;
+	while(bucket < bounds.size() && value > bounds[bucket]) {
+		bucket++;
+	}
+	counts[bucket]++;
+	sum += value;
+	count++;
+}
+
+const QVector<double>& Histogram::getBounds() const
+{
+	return bounds;
+}
+
+const QVector<quint64>& Histogram::getCounts() const
+{
+	return counts;
+}
+
+double Histogram::getSum() const
+{
+	return sum;
+}
+
+quint64 Histogram::getCount() const
+{
+	return count;
+}
+
+Metrics::~Metrics()
+{
+	// Remove all metrics and deallocate memory
+	for(const auto &family : families) {
+		for(const auto &counter : family->counters) {
+			delete counter.second;
+		}
+		for(const auto &histogram : family->histograms) {
+			delete histogram.second;
+		}
+	}
+	qDeleteAll(families.begin(), families.end());
+	families.clear();
+}
+
+Metrics::Family *Metrics::getFamily(const QString &name, const QString &help, const QString &type)
+{
+	for(const auto &family : families) {
+		if(family->name == name) {
+			return family;
+		}
+	}
+
+	Family *family = new Family;
+	family->name = name;
+	family->help = help;
+	family->type = type;
+	families.append(family);
+	return family;
+}
+
+Counter *Metrics::addCounter(const QString &name, const QString &help, const QString &labels)
+{
+	Counter *counter = new Counter;
+	getFamily(name, help, "counter")->counters.append(qMakePair(labels, counter));
+	return counter;
+}
+
+Histogram *Metrics::addHistogram(const QString &name, const QString &help, const QString &labels)
+{
+	Histogram *histogram = new Histogram(DurationBounds);
+	getFamily(name, help, "histogram")->histograms.append(qMakePair(labels, histogram));
+	return histogram;
+}
+
+void Metrics::addCollector(const QString &name, const QString &help, const QString &type, const std::function<Samples()> &collect)
+{
+	getFamily(name, help, type)->collectors.append(collect);
+}
+
+void Metrics::addScrapeHook(const std::function<void()> &hook)
+{
+	scrapeHooks.append(hook);
+}
+
+static QByteArray sample(const QString &name, const QString &labels, const QByteArray &value)
+{
+	return (labels.isEmpty() ? name : name + "{" + labels + "}").toUtf8() + " " + value + "\n";
+}
+
+static QString addLabel(const QString &labels, const QString &label)
+{
+	return labels.isEmpty() ? label : labels + "," + label;
+}
+
+QByteArray Metrics::toPrometheus() const
+{
+	QByteArray output;
+
+	// Let collectors sharing a costly snapshot take it once per scrape
+	for(const auto &hook : scrapeHooks) {
+		hook();
+	}
+
+	for(const auto &family : families) {
+		output += "# HELP " + family->name.toUtf8() + " " + family->help.toUtf8() + "\n";
+		output += "# TYPE " + family->name.toUtf8() + " " + family->type.toUtf8() + "\n";
+
+		for(const auto &counter : family->counters) {
+			output += sample(family->name, counter.first, QByteArray::number(counter.second->getValue()));
+		}
+
+		// Buckets are cumulative in the Prometheus format
+		for(const auto &histogram : family->histograms) {
+			const QVector<double> &bounds = histogram.second->getBounds();
+			const QVector<quint64> &counts = histogram.second->getCounts();
+			quint64 cumulative = 0;
+			for(int i = 0; i < counts.size(); i++) {
+				cumulative += counts[i];
+				QString le = i < bounds.size() ? QString::number(bounds[i]) : "+Inf";
+				output += sample(family->name + "_bucket", addLabel(histogram.first, "le=\"" + le + "\""), QByteArray::number(cumulative));
+			}
+			output += sample(family->name + "_sum", histogram.first, QByteArray::number(histogram.second->getSum(), 'g', 10));
+			output += sample(family->name + "_count", histogram.first, QByteArray::number(histogram.second->getCount()));
+		}
+
+		for(const auto &collect : family->collectors) {
+			for(const auto &value : collect()) {
+				output += sample(family->name, value.first, QByteArray::number(value.second, 'g', 15));
+			}
+		}
+	}
+
+	return output;
+}
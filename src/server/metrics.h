@@ -0,0 +1,75 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QString>
+#include <QList>
+#include <QPair>
+#include <QVector>
+#include <functional>
+
+// Counters and histograms are updated on hot paths, so updating them is kept to a few additions
+class Counter
+{
+	private:
+		quint64 value;
+
+	public:
+		Counter() : value(0) {}
+
+		void increment(quint64 amount = 1) { value += amount; }
+		quint64 getValue() const { return value; }
+};
+
+class Histogram
+{
+	private:
+		QVector<double> bounds;
+		QVector<quint64> counts;
+		double sum;
+		quint64 count;
+
+	public:
+		Histogram(const QVector<double> &bounds);
+
+		void observe(double value);
+
+		const QVector<double>& getBounds() const;
+		const QVector<quint64>& getCounts() const;
+		double getSum() const;
+		quint64 getCount() const;
+};
+
+// Collects metrics and renders them in the Prometheus text format
+class Metrics
+{
+	public:
+		typedef QList<QPair<QString, double>> Samples;
+
+	private:
+		struct Family
+		{
+			QString name;
+			QString help;
+			QString type;
+			QList<QPair<QString, Counter *>> counters;
+			QList<QPair<QString, Histogram *>> histograms;
+			QList<std::function<Samples()>> collectors;
+		};
+
+		QList<Family *> families;
+		QList<std::function<void()>> scrapeHooks;
+
+		Family *getFamily(const QString &name, const QString &help, const QString &type);
+
+	public:
+		~Metrics();
+
+		Counter *addCounter(const QString &name, const QString &help, const QString &labels = QString());
+		Histogram *addHistogram(const QString &name, const QString &help, const QString &labels = QString());
+		void addCollector(const QString &name, const QString &help, const QString &type, const std::function<Samples()> &collect);
+		void addScrapeHook(const std::function<void()> &hook);
+
+		QByteArray toPrometheus() const;
+};
+
+#endif
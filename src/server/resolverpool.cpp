@@ -0,0 +1,96 @@
+#include "resolverpool.h"
+
+ResolverPool::ResolverPool(QMdnsEngine::AbstractServer *server, QMdnsEngine::Cache *cache, QObject *parent) :
+	QObject(parent),
+	server(server),
+	cache(cache)
+{
+}
+
+QList<QHostAddress> ResolverPool::acquire(const QByteArray &fullName, const QByteArray &hostname)
+{
+	// Nothing changes when the service already uses a resolver for this host
+	if(hostnames.contains(fullName)) {
+		if(hostnames[fullName] == hostname) {
+			return hosts[hostname].addresses;
+		}
+		release(fullName);
+	}
+
+	// Share a single resolver between all services on the same host, using a lambda expression
+	if(!hosts.contains(hostname)) {
+		QMdnsEngine::Resolver *resolver = new QMdnsEngine::Resolver(server, hostname, cache, this);
+		connect(resolver, &QMdnsEngine::Resolver::resolved, this, [this,hostname](const QHostAddress &address) {
+			onResolved(hostname, address);
+		});
+		connect(resolver, &QMdnsEngine::Resolver::addressExpired, this, [this,hostname](const QHostAddress &address) {
+			onAddressExpired(hostname, address);
+		});
+		hosts[hostname].resolver = resolver;
+	}
+
+	hosts[hostname].services.insert(fullName);
+	hostnames[fullName] = hostname;
+
+	// The service is immediately known by the addresses that were already resolved for the host
+	return hosts[hostname].addresses;
+}
+
+void ResolverPool::release(const QByteArray &fullName)
+{
+	if(!hostnames.contains(fullName)) {
+		return;
+	}
+
+	QByteArray hostname = hostnames.take(fullName);
+	Host &host = hosts[hostname];
+	host.services.remove(fullName);
+
+	// Remove the resolver and deallocate memory when the last service on the host is gone
+	if(host.services.empty()) {
+		host.resolver->deleteLater();
+		hosts.remove(hostname);
+	}
+}
+
+void ResolverPool::onResolved(const QByteArray &hostname, const QHostAddress &address)
+{
+	// The resolver may still emit after its last service was released
+	if(!hosts.contains(hostname)) {
+		return;
+	}
+
+	Host &host = hosts[hostname];
+
+	// Prevent duplicate address entries, if for some reason that address is resolved more than once
+	if(host.addresses.contains(address)) {
+		return;
+	}
+	host.addresses.append(address);
+
+	// Notify every service on the host
+	const QSet<QByteArray> services = host.services;
+	for(const auto &fullName : services) {
+		emit resolved(fullName, address);
+	}
+}
+
+void ResolverPool::onAddressExpired(const QByteArray &hostname, const QHostAddress &address)
+{
+	// The resolver may still emit after its last service was released
+	if(!hosts.contains(hostname)) {
+		return;
+	}
+
+	Host &host = hosts[hostname];
+
+	if(!host.addresses.removeOne(address)) {
+		return;
+	}
+
+	// Notify every service on the host
+	const QSet<QByteArray> services = host.services;
+	for(const auto &fullName : services) {
+		emit addressExpired(fullName, address);
+	}
+}
@@ -0,0 +1,42 @@
+#ifndef RESOLVERPOOL_H
+#define RESOLVERPOOL_H
+
+#include <QHostAddress>
+#include <QSet>
+#include <qmdnsengine/abstractserver.h>
+#include <qmdnsengine/cache.h>
+#include <qmdnsengine/resolver.h>
+
+class ResolverPool : public QObject
+{
+	Q_OBJECT
+
+	private:
+		struct Host
+		{
+			QMdnsEngine::Resolver *resolver;
+			QSet<QByteArray> services;
+			QList<QHostAddress> addresses;
+		};
+
+		QMdnsEngine::AbstractServer *server;
+		QMdnsEngine::Cache *cache;
+
+		QMap<QByteArray, Host> hosts;
+		QMap<QByteArray, QByteArray> hostnames;
+
+		void onResolved(const QByteArray &hostname, const QHostAddress &address);
+		void onAddressExpired(const QByteArray &hostname, const QHostAddress &address);
+
+	public:
+		ResolverPool(QMdnsEngine::AbstractServer *server, QMdnsEngine::Cache *cache, QObject *parent);
+
+		QList<QHostAddress> acquire(const QByteArray &fullName, const QByteArray &hostname);
+		void release(const QByteArray &fullName);
+
+	signals:
+		void resolved(const QByteArray &fullName, const QHostAddress &address);
+		void addressExpired(const QByteArray &fullName, const QHostAddress &address);
+};
+
+#endif
@@ -3,27 +3,183 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QElapsedTimer>
+#include <QUrlQuery>
+#include <QUuid>
+#include <qmdnsengine/trace.h>
+#ifdef Q_OS_UNIX
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#endif
 #include "../common/messagetype.h"
 
-ServerSocket::ServerSocket(ServiceRepository &serviceRepository, const QString &name, const QString &address, quint16 port, bool verbose) :
+// Smaller messages are always sent uncompressed, as compressing them barely reduces their size
+static const int CompressionThreshold = 1024;
+
+// Maximum size of the services in a single chunk of a streamed snapshot, the next chunk is only queued once the
+// client's queue drops below this size
+static const int SnapshotChunkSize = 64 * 1024;
+
+// Clients that didn't respond to this many pings in a row are disconnected
+static const int MaxMissedPings = 3;
+
+// Amount of changes remembered to send clients only what changed since their revision
+static const int JournalSize = 64 * 1024;
+
+ServerSocket::ServerSocket(ServiceRepository &serviceRepository, Metrics &metrics, const QString &name, const QString &address, quint16 port, int maxAcceptRate, int maxSnapshotRate, int pingInterval, bool reusePort, bool indentedJson, bool verbose) :
 	QObject(),
 	serviceRepository(serviceRepository),
+	maxAcceptRate(maxAcceptRate),
+	maxSnapshotRate(maxSnapshotRate),
+	pingInterval(pingInterval),
+	indentedJson(indentedJson),
 	verbose(verbose),
-	webSocketServer(name, QWebSocketServer::NonSecureMode, this)
+	webSocketServer(name, QWebSocketServer::NonSecureMode, this),
+	acceptedConnections(0),
+	acceptTimer(this),
+	snapshotTimer(this),
+	pingTimer(this),
+	snapshotChunksValid(false)
 {
-	// Observe the repository
-	serviceRepository.setObserver(this);
+	// Observe the repository, revisions are only meaningful to clients for as long as this server runs
+	// The repository is rediscovered from scratch after a restart, so reusing an epoch would let revisions of different
+	// services collide, instead every client that reconnects after a restart of the server receives a full snapshot
+	serviceRepository.addObserver(this);
+	serviceRepository.setEpoch(QUuid::createUuid().toRfc4122().toHex());
+
+	// Register metrics
+	registerMetrics(metrics);
 
 	// Register event handlers
 	connect(&webSocketServer, &QWebSocketServer::closed, this, &ServerSocket::onClosed);
 	connect(&webSocketServer, &QWebSocketServer::newConnection, this, &ServerSocket::onClientConnected);
+	connect(&acceptTimer, &QTimer::timeout, this, &ServerSocket::onAcceptTimeout);
+	connect(&snapshotTimer, &QTimer::timeout, this, &ServerSocket::onSnapshotTimeout);
+	connect(&pingTimer, &QTimer::timeout, this, &ServerSocket::onPingTimeout);
 
-	// Start listening for incoming connections
-	if(webSocketServer.listen(QHostAddress(address), port)) {
+	// Count the accepted connections per second and serve the queued snapshots at an even pace
+	acceptTimer.setInterval(1000);
+	if(maxSnapshotRate > 0) {
+		snapshotTimer.setInterval(qMax(1, 1000 / maxSnapshotRate));
+	}
+
+	// Ping the clients and send them the current revision
+	clock.start();
+	if(pingInterval > 0) {
+		pingTimer.start(pingInterval);
+	}
+
+	// Start listening for incoming connections, several processes can share the port to let the kernel balance the
+	// connections between them
+	bool listening = reusePort
+		? listenReusePort(QHostAddress(address), port)
+		: webSocketServer.listen(QHostAddress(address), port);
+	if(listening) {
 		if(verbose) qDebug() << "Listening on address" << address << "and port" << port;
 	}
 }
 
+bool ServerSocket::listenReusePort(const QHostAddress &address, quint16 port)
+{
+#ifdef Q_OS_UNIX
+	// Qt doesn't expose SO_REUSEPORT, so create the listening socket and hand it over
+	bool ipv6 = address.protocol() == QAbstractSocket::IPv6Protocol;
+	int fd = socket(ipv6 ? AF_INET6 : AF_INET, SOCK_STREAM, 0);
+	if(fd < 0) {
+		qWarning() << "Failed to create socket:" << strerror(errno);
+		return false;
+	}
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	int enable = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+	if(setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0) {
+		qWarning() << "Failed to enable SO_REUSEPORT:" << strerror(errno);
+		close(fd);
+		return false;
+	}
+
+	int result;
+	if(ipv6) {
+		sockaddr_in6 socketAddress = {};
+		socketAddress.sin6_family = AF_INET6;
+		socketAddress.sin6_port = htons(port);
+		Q_IPV6ADDR ipv6Address = address.toIPv6Address();
+		memcpy(&socketAddress.sin6_addr, &ipv6Address, sizeof(socketAddress.sin6_addr));
+		result = bind(fd, reinterpret_cast<sockaddr *>(&socketAddress), sizeof(socketAddress));
+	}
+	else {
+		sockaddr_in socketAddress = {};
+		socketAddress.sin_family = AF_INET;
+		socketAddress.sin_port = htons(port);
+		socketAddress.sin_addr.s_addr = htonl(address.toIPv4Address());
+		result = bind(fd, reinterpret_cast<sockaddr *>(&socketAddress), sizeof(socketAddress));
+	}
+
+	if(result < 0 || listen(fd, SOMAXCONN) < 0 || !webSocketServer.setSocketDescriptor(fd)) {
+		qWarning() << "Failed to listen on address" << address.toString() << "and port" << port << ":" << strerror(errno);
+		close(fd);
+		return false;
+	}
+
+	return true;
+#else
+	Q_UNUSED(address);
+	Q_UNUSED(port);
+	qWarning() << "Sharing the port with SO_REUSEPORT is not supported on this platform";
+	return false;
+#endif
+}
+
+void ServerSocket::registerMetrics(Metrics &metrics)
+{
+	const QList<QPair<int, QString>> types = {
+		{MessageType::ALL, "all"},
+		{MessageType::ADD_OR_UPDATE, "add_or_update"},
+		{MessageType::REMOVE, "remove"},
+		{MessageType::ALL_BEGIN, "all_begin"},
+		{MessageType::ALL_CHUNK, "all_chunk"},
+		{MessageType::ALL_END, "all_end"},
+		{MessageType::DELTA, "delta"},
+		{MessageType::HEARTBEAT, "heartbeat"}
+	};
+	for(const auto &type : types) {
+		QString label = "type=\"" + type.second + "\"";
+		messagesSent[type.first] = metrics.addCounter("websocket_messages_sent_total", "Messages sent to websocket clients.", label);
+		bytesSent[type.first] = metrics.addCounter("websocket_bytes_sent_total", "Bytes of messages sent to websocket clients.", label);
+	}
+
+	snapshotDuration = metrics.addHistogram("websocket_snapshot_queue_duration_seconds", "Time to build a snapshot of all services for a client and queue it on the websocket, not including writing it to the network.");
+	compressions = metrics.addCounter("websocket_compressions_total", "Messages compressed, once for all clients that requested compression.");
+	broadcastDuration = metrics.addHistogram("websocket_broadcast_queue_duration_seconds", "Time to build a service change and queue it on the websockets of all clients, not including writing it to the network.");
+
+	metrics.addCollector("websocket_clients", "Connected websocket clients.", "gauge", [this]() {
+		return Metrics::Samples{{QString(), double(clients.size())}};
+	});
+	metrics.addCollector("websocket_queued_bytes", "Bytes queued for websocket clients but not yet written.", "gauge", [this]() {
+		qint64 total = 0;
+		qint64 maximum = 0;
+		for(const auto &bytes : pendingBytes) {
+			total += bytes;
+			maximum = qMax(maximum, bytes);
+		}
+		return Metrics::Samples{{"aggregate=\"sum\"", double(total)}, {"aggregate=\"max\"", double(maximum)}};
+	});
+	metrics.addCollector("websocket_snapshot_queue", "Clients waiting for a snapshot of all services.", "gauge", [this]() {
+		return Metrics::Samples{{QString(), double(snapshotQueue.size())}};
+	});
+	metrics.addCollector("repository_services", "Services in the repository.", "gauge", [this]() {
+		return Metrics::Samples{{QString(), double(serviceRepository.getServices().size())}};
+	});
+	metrics.addCollector("repository_addresses", "Services with resolved addresses in the repository.", "gauge", [this]() {
+		return Metrics::Samples{{QString(), double(serviceRepository.getAddresses().size())}};
+	});
+}
+
 ServerSocket::~ServerSocket()
 {
 	// Stop listening for incoming connections
@@ -48,16 +204,56 @@ void ServerSocket::onClientConnected()
 
 	// Get the new websocket connection
 	QWebSocket *client = webSocketServer.nextPendingConnection();
+	if(!client) {
+		return;
+	}
+
+	// Stop accepting connections for the rest of the second once the limit is reached, they wait in the backlog
+	if(maxAcceptRate > 0) {
+		if(!acceptTimer.isActive()) {
+			acceptTimer.start();
+		}
+		if(++acceptedConnections >= maxAcceptRate) {
+			webSocketServer.pauseAccepting();
+		}
+	}
 
 	// Register event handlers
 	connect(client, &QWebSocket::disconnected, this, &ServerSocket::onClientDisconnected);
 	connect(client, &QWebSocket::textMessageReceived, this, &ServerSocket::onTextMessageReceived);
+	connect(client, &QWebSocket::bytesWritten, this, &ServerSocket::onBytesWritten);
+	connect(client, &QWebSocket::pong, this, &ServerSocket::onPong);
 
 	// Add the connection to the list of connected clients
 	clients.append(client);
+	pendingBytes[client] = 0;
+	lastSeen[client] = clock.elapsed();
 
-	// Send a list of all services to the client
-	notifyClientAllServices(client);
+	// Clients request compression when connecting, for example 'ws://localhost:1234?compression=deflate'
+	// Like HTTP's deflate content coding, compressed messages are zlib streams (RFC 1950) sent as binary frames
+	QUrlQuery query(client->requestUrl());
+	if(query.queryItemValue("compression") == "deflate") {
+		if(verbose) qDebug() << "Client requested compression";
+		compressedClients.insert(client);
+	}
+
+	// Clients request snapshots in chunks when connecting, for example 'ws://localhost:1234?snapshot=stream'
+	if(query.queryItemValue("snapshot") == "stream") {
+		if(verbose) qDebug() << "Client requested streamed snapshots";
+		streamedClients.insert(client);
+	}
+
+	// Clients that still have the services of an earlier revision only need the changes since then, otherwise send a
+	// list of all services to the client
+	synchronizeClient(client, query.queryItemValue("epoch").toUtf8(), query.queryItemValue("since"));
+}
+
+void ServerSocket::synchronizeClient(QWebSocket *client, const QByteArray &epoch, const QString &since)
+{
+	bool known = !epoch.isEmpty() && epoch == serviceRepository.getEpoch() && !since.isEmpty();
+	if(!known || !notifyClientChanges(client, since.toULongLong())) {
+		requestClientAllServices(client);
+	}
 }
 
 void ServerSocket::onClientDisconnected()
@@ -68,6 +264,14 @@ void ServerSocket::onClientDisconnected()
 	QWebSocket *client = qobject_cast<QWebSocket *>(sender());
 	if(client) {
 		clients.removeAll(client);
+		pendingBytes.remove(client);
+		lastSeen.remove(client);
+		compressedClients.remove(client);
+		streamedClients.remove(client);
+		streams.remove(client);
+		if(queuedClients.remove(client)) {
+			snapshotQueue.removeAll(client);
+		}
 		client->deleteLater();
 	}
 }
@@ -79,10 +283,18 @@ void ServerSocket::onTextMessageReceived(const QString &message)
 	if(client) {
 		QJsonDocument jsonDocument = QJsonDocument::fromJson(message.toUtf8());
 		QJsonObject jsonMessage = jsonDocument.object();
+		lastSeen[client] = clock.elapsed();
 
 		switch(jsonMessage["type"].toInt()) {
 			case MessageType::REFRESH: {
-				notifyClientAllServices(client);
+				requestClientAllServices(client);
+				break;
+			}
+			case MessageType::SYNC: {
+				// Ignore clients that are about to receive a snapshot anyway
+				if(!queuedClients.contains(client) && !streams.contains(client)) {
+					synchronizeClient(client, jsonMessage["epoch"].toString().toUtf8(), jsonMessage["since"].toString());
+				}
 				break;
 			}
 			default: {
@@ -93,74 +305,368 @@ void ServerSocket::onTextMessageReceived(const QString &message)
 	}
 }
 
-QJsonObject ServerSocket::createJsonService(const QMdnsEngine::Service &service)
+void ServerSocket::onBytesWritten(qint64 bytes)
 {
-	// Differentiate between service types of the same service
-	QByteArray fullName = serviceRepository.getServiceFullName(service);
+	// Written bytes include the websocket framing, so never go below an empty queue
+	QWebSocket *client = qobject_cast<QWebSocket *>(sender());
+	if(client && pendingBytes.contains(client)) {
+		pendingBytes[client] = qMax(qint64(0), pendingBytes[client] - bytes);
+
+		// Queue the next chunk of a streamed snapshot
+		if(streams.contains(client)) {
+			continueStream(client);
+		}
+	}
+}
+
+QByteArray ServerSocket::compressMessage(const QByteArray &message)
+{
+	// Indented messages are meant to be read, so leave them uncompressed
+	if(message.size() < CompressionThreshold || indentedJson || compressedClients.isEmpty()) {
+		return QByteArray();
+	}
+
+	QMDNSENGINE_TRACE_SPAN("compress", "server");
+
+	compressions->increment();
+
+	// Strip the 4-byte uncompressed length qCompress() puts in front of the zlib stream
+	return qCompress(message).mid(4);
+}
+
+void ServerSocket::sendMessage(QWebSocket *client, int type, const QByteArray &message, const QByteArray &compressedMessage)
+{
+	QMDNSENGINE_TRACE_SPAN("send", "server");
+
+	// Compressed messages are sent as binary frames, all others as text frames
+	qint64 size;
+	if(!compressedMessage.isEmpty() && compressedClients.contains(client)) {
+		size = client->sendBinaryMessage(compressedMessage);
+	}
+	// Messages are built compact, only reformat them when explicitly asked for
+	else if(indentedJson) {
+		size = client->sendTextMessage(QJsonDocument::fromJson(message).toJson(QJsonDocument::Indented));
+	} else {
+		size = client->sendTextMessage(message);
+	}
+
+	pendingBytes[client] += size;
+	messagesSent[type]->increment();
+	bytesSent[type]->increment(size);
+}
+
+void ServerSocket::onPong()
+{
+	QWebSocket *client = qobject_cast<QWebSocket *>(sender());
+	if(client && lastSeen.contains(client)) {
+		lastSeen[client] = clock.elapsed();
+	}
+}
+
+void ServerSocket::onPingTimeout()
+{
+	qint64 now = clock.elapsed();
+	QByteArray json = "{\"type\":" + QByteArray::number(MessageType::HEARTBEAT) + ",\"revision\":" + QByteArray::number(serviceRepository.getRevision()) + ",\"epoch\":\"" + serviceRepository.getEpoch() + "\"}";
+
+	// Aborting a client removes it from the list
+	const QList<QWebSocket *> currentClients = clients;
+	for(const auto &client : currentClients) {
+		if(now - lastSeen.value(client) > MaxMissedPings * pingInterval) {
+			if(verbose) qDebug() << "Client stopped responding";
+			client->abort();
+			continue;
+		}
+
+		client->ping();
+
+		// Clients waiting for or receiving a snapshot are not at any revision yet
+		if(!queuedClients.contains(client) && !streams.contains(client)) {
+			sendMessage(client, MessageType::HEARTBEAT, json, QByteArray());
+		}
+	}
+}
 
-	QJsonObject jsonService;
-	jsonService["name"] = QString(service.name());
-	jsonService["hostname"] = QString(service.hostname());
-	jsonService["port"] = service.port();
-	jsonService["type"] = QString(service.type());
-	jsonService["fullname"] = QString(fullName);
+void ServerSocket::onAcceptTimeout()
+{
+	// Start a new second
+	acceptedConnections = 0;
+	acceptTimer.stop();
+	webSocketServer.resumeAccepting();
+}
 
-	QJsonObject jsonAttributes;
-	QMap<QByteArray, QByteArray> attributes = service.attributes();
-	for(auto it = attributes.begin(); it != attributes.end(); it++) {
-		jsonAttributes[it.key()] = QString(it.value());
+void ServerSocket::requestClientAllServices(QWebSocket *client)
+{
+	if(maxSnapshotRate <= 0) {
+		notifyClientAllServices(client);
+		return;
 	}
-	jsonService["attributes"] = jsonAttributes;
 
-	QJsonArray jsonAddresses;
-	for(const auto &address : serviceRepository.getAddresses()[fullName]) {
-		jsonAddresses.append(address);
+	// Queue the client, the snapshot it gets is built when it's its turn so it includes all changes until then
+	if(!queuedClients.contains(client)) {
+		snapshotQueue.append(client);
+		queuedClients.insert(client);
+	}
+	if(!snapshotTimer.isActive()) {
+		onSnapshotTimeout();
+		snapshotTimer.start();
 	}
-	jsonService["addresses"] = jsonAddresses;
+}
 
-	return jsonService;
+void ServerSocket::onSnapshotTimeout()
+{
+	if(snapshotQueue.isEmpty()) {
+		snapshotTimer.stop();
+		return;
+	}
+
+	QWebSocket *client = snapshotQueue.takeFirst();
+	queuedClients.remove(client);
+	notifyClientAllServices(client);
 }
 
 void ServerSocket::notifyClientAllServices(QWebSocket *client)
 {
-	QJsonArray jsonServices;
+	if(streamedClients.contains(client)) {
+		streamClientAllServices(client);
+		return;
+	}
+
+	QMDNSENGINE_TRACE_SPAN("snapshot", "server");
+
+	QElapsedTimer timer;
+	timer.start();
+
+	// Splice the encoded services into the message instead of building a document, the result is shared by all
+	// clients until a service changes
+	if(snapshot.isEmpty()) {
+		snapshot = "{\"type\":" + QByteArray::number(MessageType::ALL) + ",\"revision\":" + QByteArray::number(serviceRepository.getRevision()) + ",\"epoch\":\"" + serviceRepository.getEpoch() + "\",\"services\":[";
+		QMap<QByteArray, QMdnsEngine::Service> &services = serviceRepository.getServices();
+		for(auto it = services.begin(); it != services.end(); it++) {
+			if(it != services.begin()) {
+				snapshot += ',';
+			}
+			snapshot += serviceRepository.getJsonService(*it);
+		}
+		snapshot += "]}";
+	}
+
+	// Compress the snapshot once for all clients that requested compression
+	if(compressedSnapshot.isEmpty() && compressedClients.contains(client)) {
+		compressedSnapshot = compressMessage(snapshot);
+	}
+
+	sendMessage(client, MessageType::ALL, snapshot, compressedSnapshot);
+
+	snapshotDuration->observe(timer.nsecsElapsed() / 1e9);
+}
+
+void ServerSocket::streamClientAllServices(QWebSocket *client)
+{
+	QMDNSENGINE_TRACE_SPAN("snapshotStream", "server");
+
+	QElapsedTimer timer;
+	timer.start();
+
+	// Split the encoded services into chunks of bounded size, the chunks are shared by all clients until a service
+	// changes
 	QMap<QByteArray, QMdnsEngine::Service> &services = serviceRepository.getServices();
-	for(auto it = services.begin(); it != services.end(); it++) {
-		jsonServices.append(createJsonService(*it));
+	if(!snapshotChunksValid) {
+		QByteArray chunk;
+		for(auto it = services.begin(); it != services.end(); it++) {
+			if(chunk.isEmpty()) {
+				chunk = "{\"type\":" + QByteArray::number(MessageType::ALL_CHUNK) + ",\"services\":[";
+			} else {
+				chunk += ',';
+			}
+			chunk += serviceRepository.getJsonService(*it);
+
+			if(chunk.size() >= SnapshotChunkSize) {
+				snapshotChunks.append(chunk + "]}");
+				chunk.clear();
+			}
+		}
+		if(!chunk.isEmpty()) {
+			snapshotChunks.append(chunk + "]}");
+		}
+		snapshotChunksValid = true;
 	}
-	
-	QJsonObject jsonMessage;
-	jsonMessage["type"] = MessageType::ALL;
-	jsonMessage["services"] = jsonServices;
 
-	QJsonDocument jsonDocument(jsonMessage);
-	client->sendTextMessage(jsonDocument.toJson());
+	// Compress the chunks once for all clients that requested compression
+	if(compressedClients.contains(client) && compressedSnapshotChunks.size() != snapshotChunks.size()) {
+		compressedSnapshotChunks.clear();
+		for(const auto &chunk : snapshotChunks) {
+			compressedSnapshotChunks.append(compressMessage(chunk));
+		}
+	}
+
+	// A new snapshot replaces one that is still being streamed, including the changes that were held back
+	SnapshotStream stream;
+	stream.chunks = snapshotChunks;
+	if(compressedClients.contains(client)) {
+		stream.compressedChunks = compressedSnapshotChunks;
+	}
+	stream.position = 0;
+	streams[client] = stream;
+
+	QByteArray json = "{\"type\":" + QByteArray::number(MessageType::ALL_BEGIN) + ",\"revision\":" + QByteArray::number(serviceRepository.getRevision()) + ",\"epoch\":\"" + serviceRepository.getEpoch() + "\",\"count\":" + QByteArray::number(services.size()) + ",\"chunks\":" + QByteArray::number(snapshotChunks.size()) + "}";
+	sendMessage(client, MessageType::ALL_BEGIN, json, QByteArray());
+
+	snapshotDuration->observe(timer.nsecsElapsed() / 1e9);
+
+	continueStream(client);
 }
 
-void ServerSocket::onAddOrUpdateService(const QMdnsEngine::Service &service)
+bool ServerSocket::notifyClientChanges(QWebSocket *client, quint64 since)
 {
-	QJsonObject jsonMessage;
-	jsonMessage["type"] = MessageType::ADD_OR_UPDATE;
-	jsonMessage["service"] = createJsonService(service);
+	QMDNSENGINE_TRACE_SPAN("delta", "server");
 
-	QJsonDocument jsonDocument(jsonMessage);
-	QByteArray json = jsonDocument.toJson();
+	// The changes are unknown when the client is ahead or when they were dropped from the journal already
+	quint64 revision = serviceRepository.getRevision();
+	if(since > revision || (since < revision && (journal.isEmpty() || journal.first().first > since + 1))) {
+		return false;
+	}
+
+	// Walk back from the newest change, only the latest state of each service matters
+	QMap<QByteArray, QMdnsEngine::Service> &services = serviceRepository.getServices();
+	QSet<QByteArray> fullNames;
+	QByteArray jsonServices;
+	QJsonArray jsonRemoved;
+	for(int i = journal.size() - 1; i >= 0 && journal[i].first > since; i--) {
+		const QByteArray &fullName = journal[i].second;
+		if(fullNames.contains(fullName)) {
+			continue;
+		}
+		fullNames.insert(fullName);
+
+		auto service = services.find(fullName);
+		if(service != services.end()) {
+			if(!jsonServices.isEmpty()) {
+				jsonServices += ',';
+			}
+			jsonServices += serviceRepository.getJsonService(*service);
+		} else {
+			jsonRemoved.append(QString(fullName));
+		}
+	}
+
+	if(verbose) qDebug() << "Sending" << fullNames.size() << "changes since revision" << since;
+
+	QByteArray json = "{\"type\":" + QByteArray::number(MessageType::DELTA) + ",\"revision\":" + QByteArray::number(revision) + ",\"epoch\":\"" + serviceRepository.getEpoch() + "\",\"services\":[" + jsonServices + "],\"removed\":" + QJsonDocument(jsonRemoved).toJson(QJsonDocument::Compact) + "}";
+	sendMessage(client, MessageType::DELTA, json, compressMessage(json));
+
+	return true;
+}
+
+void ServerSocket::addToJournal(const QByteArray &fullName)
+{
+	journal.append(qMakePair(serviceRepository.getRevision(), fullName));
+	if(journal.size() > JournalSize) {
+		journal.removeFirst();
+	}
+}
+
+void ServerSocket::continueStream(QWebSocket *client)
+{
+	SnapshotStream &stream = streams[client];
+
+	// Only queue chunks while the client keeps up, so at most about one chunk is buffered per client
+	while(stream.position < stream.chunks.size() && pendingBytes[client] < SnapshotChunkSize) {
+		QByteArray compressedChunk = stream.compressedChunks.value(stream.position);
+		sendMessage(client, MessageType::ALL_CHUNK, stream.chunks[stream.position], compressedChunk);
+		stream.position++;
+	}
+
+	if(stream.position < stream.chunks.size()) {
+		return;
+	}
+
+	// Mark the end of the snapshot and send the changes that happened in the meantime
+	QByteArray json = "{\"type\":" + QByteArray::number(MessageType::ALL_END) + "}";
+	sendMessage(client, MessageType::ALL_END, json, QByteArray());
+
+	QList<QueuedMessage> deferred = stream.deferred;
+	streams.remove(client);
+	for(const auto &message : deferred) {
+		sendMessage(client, message.type, message.message, message.compressedMessage);
+	}
+}
+
+void ServerSocket::invalidateSnapshot()
+{
+	snapshot.clear();
+	compressedSnapshot.clear();
+	snapshotChunksValid = false;
+	snapshotChunks.clear();
+	compressedSnapshotChunks.clear();
+}
+
+void ServerSocket::broadcastMessage(int type, const QByteArray &message)
+{
+	QByteArray compressedMessage = compressMessage(message);
 
 	for(const auto &client : clients) {
-		client->sendTextMessage(json);
+		// Skip clients waiting for a snapshot, it will include this change
+		if(queuedClients.contains(client)) {
+			continue;
+		}
+
+		// Hold back changes for clients still receiving a snapshot, as the snapshot's chunks predate them
+		auto stream = streams.find(client);
+		if(stream != streams.end()) {
+			stream->deferred.append({type, message, compressedMessage});
+		} else {
+			sendMessage(client, type, message, compressedMessage);
+		}
 	}
 }
 
+void ServerSocket::onAddOrUpdateService(const QMdnsEngine::Service &service)
+{
+	QMDNSENGINE_TRACE_SPAN("broadcastAddOrUpdate", "server");
+
+	QElapsedTimer timer;
+	timer.start();
+
+	// The snapshot is outdated
+	invalidateSnapshot();
+
+	// Differentiate between service types of the same service
+	addToJournal(serviceRepository.getServiceFullName(service));
+
+	QByteArray json = "{\"type\":" + QByteArray::number(MessageType::ADD_OR_UPDATE) + ",\"revision\":" + QByteArray::number(serviceRepository.getRevision()) + ",\"service\":" + serviceRepository.getJsonService(service) + "}";
+	broadcastMessage(MessageType::ADD_OR_UPDATE, json);
+
+	broadcastDuration->observe(timer.nsecsElapsed() / 1e9);
+}
+
 void ServerSocket::onRemoveService(const QString &fullName)
 {
+	QMDNSENGINE_TRACE_SPAN("broadcastRemove", "server");
+
+	QElapsedTimer timer;
+	timer.start();
+
+	// The snapshot is outdated
+	invalidateSnapshot();
+
+	addToJournal(fullName.toUtf8());
+
 	QJsonObject jsonMessage;
 	jsonMessage["type"] = MessageType::REMOVE;
+	jsonMessage["revision"] = double(serviceRepository.getRevision());
 	jsonMessage["fullname"] = fullName;
 
 	QJsonDocument jsonDocument(jsonMessage);
-	QByteArray json = jsonDocument.toJson();
+	QByteArray json = jsonDocument.toJson(QJsonDocument::Compact);
 
-	for(const auto &client : clients) {
-		client->sendTextMessage(json);
-	}
+	broadcastMessage(MessageType::REMOVE, json);
+
+	broadcastDuration->observe(timer.nsecsElapsed() / 1e9);
+}
+
+void ServerSocket::onResetRevision()
+{
+	// The journal's revisions are no longer comparable, clients that are behind get all services instead
+	journal.clear();
+	invalidateSnapshot();
 }
\ No newline at end of file
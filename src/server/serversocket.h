@@ -3,34 +3,106 @@
 
 #include <QWebSocketServer>
 #include <QWebSocket>
+#include <QTimer>
+#include <QElapsedTimer>
 #include "../common/servicerepository.h"
+#include "metrics.h"
 
 class ServerSocket : public QObject, public Observer
 {
 	Q_OBJECT
 
 	private:
+		struct QueuedMessage
+		{
+			int type;
+			QByteArray message;
+			QByteArray compressedMessage;
+		};
+
+		// A snapshot being streamed to a client, changes are held back until the client received all chunks
+		struct SnapshotStream
+		{
+			QList<QByteArray> chunks;
+			QList<QByteArray> compressedChunks;
+			int position;
+			QList<QueuedMessage> deferred;
+		};
+
 		ServiceRepository &serviceRepository;
+		int maxAcceptRate;
+		int maxSnapshotRate;
+		int pingInterval;
+		bool indentedJson;
 		bool verbose;
 
 		QWebSocketServer webSocketServer;
 		QList<QWebSocket *> clients;
+		QSet<QWebSocket *> compressedClients;
+		QSet<QWebSocket *> streamedClients;
+		QMap<QWebSocket *, SnapshotStream> streams;
+
+		// Limits the load when many clients connect at once, for example after a restart
+		int acceptedConnections;
+		QTimer acceptTimer;
+		QList<QWebSocket *> snapshotQueue;
+		QSet<QWebSocket *> queuedClients;
+		QTimer snapshotTimer;
+
+		// Detects clients that stopped responding and tells the others the current revision
+		QTimer pingTimer;
+		QElapsedTimer clock;
+		QMap<QWebSocket *, qint64> lastSeen;
+
+		QMap<QWebSocket *, qint64> pendingBytes;
+
+		QMap<int, Counter *> messagesSent;
+		QMap<int, Counter *> bytesSent;
+		Histogram *snapshotDuration;
+		Histogram *broadcastDuration;
+		Counter *compressions;
+
+		QByteArray snapshot;
+		QByteArray compressedSnapshot;
+		bool snapshotChunksValid;
+		QList<QByteArray> snapshotChunks;
+		QList<QByteArray> compressedSnapshotChunks;
+
+		// Full names of changed services by revision, oldest first
+		QList<QPair<quint64, QByteArray>> journal;
 
-		QJsonObject createJsonService(const QMdnsEngine::Service &service);
+		void requestClientAllServices(QWebSocket *client);
+		void synchronizeClient(QWebSocket *client, const QByteArray &epoch, const QString &since);
 		void notifyClientAllServices(QWebSocket *client);
+		void streamClientAllServices(QWebSocket *client);
+		bool notifyClientChanges(QWebSocket *client, quint64 since);
+		void addToJournal(const QByteArray &fullName);
+		void continueStream(QWebSocket *client);
+		void invalidateSnapshot();
+		void broadcastMessage(int type, const QByteArray &message);
+		QByteArray compressMessage(const QByteArray &message);
+		void sendMessage(QWebSocket *client, int type, const QByteArray &message, const QByteArray &compressedMessage);
+		void registerMetrics(Metrics &metrics);
+		bool listenReusePort(const QHostAddress &address, quint16 port);
 
 	public:
-		ServerSocket(ServiceRepository &serviceRepository, const QString &name, const QString &address, quint16 port, bool verbose);
+		ServerSocket(ServiceRepository &serviceRepository, Metrics &metrics, const QString &name, const QString &address, quint16 port, int maxAcceptRate, int maxSnapshotRate, int pingInterval, bool reusePort, bool indentedJson, bool verbose);
 		~ServerSocket();
 
 		void onAddOrUpdateService(const QMdnsEngine::Service &service) override;
 		void onRemoveService(const QString &fullName) override;
+		void onResetRevision() override;
 
 	private slots:
 		void onClosed();
 		void onClientConnected();
 		void onClientDisconnected();
 		void onTextMessageReceived(const QString &message);
+		void onBytesWritten(qint64 bytes);
+		void onAcceptTimeout();
+		void onSnapshotTimeout();
+		void onPingTimeout();
+		void onPong();
 };
 
 #endif
\ No newline at end of file
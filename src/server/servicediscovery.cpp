@@ -1,58 +1,239 @@
 #include "servicediscovery.h"
-#include <qmdnsengine/resolver.h>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <qmdnsengine/dns.h>
+#include <qmdnsengine/mdns.h>
+#include <qmdnsengine/message.h>
+#include <qmdnsengine/query.h>
+#include <qmdnsengine/record.h>
+#include <qmdnsengine/trace.h>
 
-ServiceDiscovery::ServiceDiscovery(ServiceRepository &serviceRepository, const QString &type, bool noCache) :
+static QList<QByteArray> toUtf8(const QList<QString> &strings)
+{
+	QList<QByteArray> utf8;
+	for(const auto &string : strings) {
+		utf8.append(string.toUtf8());
+	}
+	return utf8;
+}
+
+ServiceDiscovery::ServiceDiscovery(ServiceRepository &serviceRepository, Metrics &metrics, const QList<QString> &types, bool noCache, const QString &cacheFile, int cacheMaxEntries, qint64 cacheMaxSize, int cacheMaxSourceEntries, int cacheStatsInterval) :
 	QObject(),
 	serviceRepository(serviceRepository),
 	noCache(noCache),
+	cacheFile(noCache ? QString() : cacheFile),
 	server(this),
 	cache(this),
-	browser(&server, type.toUtf8(), noCache ? nullptr : &cache, this)
+	browser(&server, toUtf8(types), noCache ? nullptr : &cache, this),
+	resolverPool(&server, noCache ? nullptr : &cache, this),
+	cacheTimer(this),
+	verifyTimer(this)
 {
 	// Register event handlers
 	connect(&browser, &QMdnsEngine::Browser::serviceAdded, this, &ServiceDiscovery::onServiceAdded);
 	connect(&browser, &QMdnsEngine::Browser::serviceUpdated, this, &ServiceDiscovery::onServiceUpdated);
 	connect(&browser, &QMdnsEngine::Browser::serviceRemoved, this, &ServiceDiscovery::onServiceRemoved);
+	connect(&resolverPool, &ResolverPool::resolved, this, &ServiceDiscovery::onAddressResolved);
+	connect(&resolverPool, &ResolverPool::addressExpired, this, &ServiceDiscovery::onAddressExpired);
+	connect(&cacheTimer, &QTimer::timeout, this, &ServiceDiscovery::saveCache);
+	connect(&verifyTimer, &QTimer::timeout, this, &ServiceDiscovery::onVerifyTimeout);
+	connect(&cache, &QMdnsEngine::Cache::statsUpdated, this, &ServiceDiscovery::onCacheStatsUpdated);
+
+	// Bound the memory used by the cache
+	cache.setMaximumEntries(cacheMaxEntries);
+	cache.setMaximumSize(cacheMaxSize);
+	cache.setMaximumEntriesPerSource(cacheMaxSourceEntries);
+
+	// Periodically report the state of the cache
+	if(cacheStatsInterval > 0) {
+		cache.setStatsInterval(cacheStatsInterval);
+	}
+
+	// Register metrics
+	registerMetrics(metrics);
+
+	// Restore the records of a previous run and periodically store them
+	if(!this->cacheFile.isEmpty()) {
+		loadCache();
+		cacheTimer.start(60 * 1000);
+	}
 }
 
 ServiceDiscovery::~ServiceDiscovery()
 {
-	// Remove all resolvers and deallocate memory
-	qDeleteAll(resolvers.begin(), resolvers.end());
-	resolvers.clear();
+	// Store the records one last time
+	if(!cacheFile.isEmpty()) {
+		saveCache();
+	}
 }
 
-void ServiceDiscovery::onServiceAdded(const QMdnsEngine::Service &service)
+void ServiceDiscovery::registerMetrics(Metrics &metrics)
 {
-	// Differentiate between service types of the same service
-	QByteArray fullName = serviceRepository.getServiceFullName(service);
+	// The collectors read the statistics taken once at the start of each scrape
+	metrics.addScrapeHook([this]() {
+		scrapedServerStats = server.stats();
+		if(!noCache) {
+			scrapedCacheStats = cache.stats();
+		}
+	});
+
+	metrics.addCollector("mdns_packets_received_total", "Multicast DNS packets received.", "counter", [this]() {
+		return Metrics::Samples{{QString(), double(scrapedServerStats.packetsReceived)}};
+	});
+	metrics.addCollector("mdns_packets_parsed_total", "Multicast DNS packets received and parsed.", "counter", [this]() {
+		return Metrics::Samples{{QString(), double(scrapedServerStats.packetsParsed)}};
+	});
+	metrics.addCollector("mdns_packets_dropped_total", "Multicast DNS packets received but dropped as malformed.", "counter", [this]() {
+		return Metrics::Samples{{QString(), double(scrapedServerStats.packetsDropped)}};
+	});
+	metrics.addCollector("mdns_bytes_received_total", "Bytes of multicast DNS packets received.", "counter", [this]() {
+		return Metrics::Samples{{QString(), double(scrapedServerStats.bytesReceived)}};
+	});
+
+	// The cache is not used at all when disabled
+	if(noCache) {
+		return;
+	}
 
-	// Remove any previous resolver from the list of resolvers and deallocate memory
-	if(resolvers.contains(fullName)) {
-		resolvers[fullName]->deleteLater();
-		resolvers.remove(fullName);
+	metrics.addCollector("mdns_cache_entries", "DNS records in the cache.", "gauge", [this]() {
+		return Metrics::Samples{{QString(), double(scrapedCacheStats.entries)}};
+	});
+	metrics.addCollector("mdns_cache_size_bytes", "Approximate size of the DNS records in the cache.", "gauge", [this]() {
+		return Metrics::Samples{{QString(), double(scrapedCacheStats.size)}};
+	});
+	metrics.addCollector("mdns_cache_lookups_total", "Lookups of DNS records in the cache.", "counter", [this]() {
+		return Metrics::Samples{{"result=\"hit\"", double(scrapedCacheStats.hits)}, {"result=\"miss\"", double(scrapedCacheStats.misses)}};
+	});
+	metrics.addCollector("mdns_cache_evictions_total", "DNS records evicted from the cache to stay within its limits.", "counter", [this]() {
+		return Metrics::Samples{{QString(), double(scrapedCacheStats.evictions)}};
+	});
+	metrics.addCollector("mdns_cache_rejections_total", "DNS records not added to the cache because of its limits.", "counter", [this]() {
+		return Metrics::Samples{{QString(), double(scrapedCacheStats.rejections)}};
+	});
+	metrics.addCollector("mdns_cache_expirations_total", "DNS records expired from the cache.", "counter", [this]() {
+		return Metrics::Samples{{QString(), double(scrapedCacheStats.expirations)}};
+	});
+}
+
+void ServiceDiscovery::loadCache()
+{
+	QFile file(cacheFile);
+	if(!file.open(QIODevice::ReadOnly)) {
+		return;
 	}
 
-	// Resolve the service in order to connect to it, using a lambda expression
-	QMdnsEngine::Resolver *resolver = new QMdnsEngine::Resolver(&server, service.hostname(), noCache ? nullptr : &cache, this);
-	connect(resolver, &QMdnsEngine::Resolver::resolved, [this,fullName,service](const QHostAddress &address) {
-		QMap<QByteArray, QList<QString>> &addresses = serviceRepository.getAddresses();
+	QDataStream stream(&file);
+	if(cache.loadRecords(stream)) {
+		verifyCache();
+	}
+}
 
-		// Prevent duplicate address entries for a service, if for some reason that address is resolved more than once
-		if(!addresses[fullName].contains(address.toString())) {
-			// Add the address to the list of addresses of this service
-			addresses[fullName].append(address.toString());
-		
-			// Notify clients
-			serviceRepository.notifyAddOrUpdateService(service);
+void ServiceDiscovery::verifyCache()
+{
+	// Query for all restored records with the records themselves as known answers, responders will only answer
+	// when a record changed or is about to expire, while the browser already reports the restored services
+	QList<QMdnsEngine::Record> records;
+	cache.lookupRecords(QByteArray(), QMdnsEngine::ANY, records);
+
+	QMap<QPair<QByteArray, quint16>, QList<QMdnsEngine::Record>> questions;
+	for(const auto &record : records) {
+		questions[qMakePair(record.name(), record.type())].append(record);
+	}
+
+	// Limit the number of questions in each message
+	QMdnsEngine::Message message;
+	int queries = 0;
+	for(auto it = questions.begin(); it != questions.end(); it++) {
+		QMdnsEngine::Query query;
+		query.setName(it.key().first);
+		query.setType(it.key().second);
+		message.addQuery(query);
+		for(const auto &record : it.value()) {
+			message.addRecord(record);
 		}
-	});
 
-	// Add the resolver to the list of resolvers to prevent it going out of scope
-	resolvers[fullName] = resolver;
+		if(++queries == 16) {
+			verifyMessages.append(message);
+			message = QMdnsEngine::Message();
+			queries = 0;
+		}
+	}
+	if(queries) {
+		verifyMessages.append(message);
+	}
+
+	// Spread the queries out instead of flooding the network with a large cache at once
+	onVerifyTimeout();
+	verifyTimer.start(100);
+}
 
-	// Add the service to the list of services
+void ServiceDiscovery::onVerifyTimeout()
+{
+	if(verifyMessages.isEmpty()) {
+		verifyTimer.stop();
+		return;
+	}
+
+	// Known answers that don't fit in a packet follow right away in packets with the TC bit set, responders wait
+	// 400-500 ms for them (RFC 6762 section 7.2)
+	const auto messages = QMdnsEngine::splitKnownAnswers(verifyMessages.takeFirst(), QMdnsEngine::MdnsMaximumPacketSize);
+	for(const auto &part : messages) {
+		server.sendMessageToAll(part);
+	}
+}
+
+void ServiceDiscovery::saveCache()
+{
+	// Write to a temporary file first, so a crash never leaves a partial file behind
+	QSaveFile file(cacheFile);
+	if(!file.open(QIODevice::WriteOnly)) {
+		return;
+	}
+
+	QDataStream stream(&file);
+	cache.saveRecords(stream);
+	file.commit();
+}
+
+void ServiceDiscovery::onCacheStatsUpdated(const QMdnsEngine::Cache::Stats &stats)
+{
+	// Print a single line per snapshot, so the output can easily be plotted over time
+	QString types;
+	for(auto it = stats.entriesByType.begin(); it != stats.entriesByType.end(); it++) {
+		types += QString(" %1=%2").arg(QMdnsEngine::typeName(it.key())).arg(it.value());
+	}
+
+	qDebug().noquote() << QString("CACHE entries=%1 bytes=%2 hits=%3 misses=%4 inserts=%5 replacements=%6 expirations=%7 evictions=%8 rejections=%9 triggers=%10")
+		.arg(stats.entries).arg(stats.size).arg(stats.hits).arg(stats.misses).arg(stats.inserts)
+		.arg(stats.replacements).arg(stats.expirations).arg(stats.evictions).arg(stats.rejections).arg(stats.pendingTriggers)
+		+ types;
+}
+
+void ServiceDiscovery::setAddresses(const QByteArray &fullName, const QList<QHostAddress> &addresses)
+{
+	QList<QString> &serviceAddresses = serviceRepository.getAddresses()[fullName];
+
+	// Replace the list of addresses of this service
+	serviceAddresses.clear();
+	for(const auto &address : addresses) {
+		serviceAddresses.append(address.toString());
+	}
+}
+
+void ServiceDiscovery::onServiceAdded(const QMdnsEngine::Service &service)
+{
+	QMDNSENGINE_TRACE_SPAN("serviceAdded", "server");
+
+	// Differentiate between service types of the same service
+	QByteArray fullName = serviceRepository.getServiceFullName(service);
+
+	// Resolve the service in order to connect to it, starting with the addresses already known for its host
+	setAddresses(fullName, resolverPool.acquire(fullName, service.hostname()));
+
+	// Add the service to the list of services, replacing the same service from a federated server
 	serviceRepository.getServices()[fullName] = service;
+	serviceRepository.getPaths().remove(fullName);
 
 	// Notify clients
 	serviceRepository.notifyAddOrUpdateService(service);
@@ -60,11 +241,19 @@ void ServiceDiscovery::onServiceAdded(const QMdnsEngine::Service &service)
 
 void ServiceDiscovery::onServiceUpdated(const QMdnsEngine::Service &service)
 {
+	QMDNSENGINE_TRACE_SPAN("serviceUpdated", "server");
+
 	// Differentiate between service types of the same service
 	QByteArray fullName = serviceRepository.getServiceFullName(service);
 
+	// Resolve the service again if it moved to another host
+	if(serviceRepository.getServices()[fullName].hostname() != service.hostname()) {
+		setAddresses(fullName, resolverPool.acquire(fullName, service.hostname()));
+	}
+
 	// Replace the service in the list of services with new data
 	serviceRepository.getServices()[fullName] = service;
+	serviceRepository.getPaths().remove(fullName);
 
 	// Notify clients
 	serviceRepository.notifyAddOrUpdateService(service);
@@ -72,14 +261,13 @@ void ServiceDiscovery::onServiceUpdated(const QMdnsEngine::Service &service)
 
 void ServiceDiscovery::onServiceRemoved(const QMdnsEngine::Service &service)
 {
+	QMDNSENGINE_TRACE_SPAN("serviceRemoved", "server");
+
 	// Differentiate between service types of the same service
 	QByteArray fullName = serviceRepository.getServiceFullName(service);
 
-	// Remove the resolver from the list of resolvers and deallocate memory
-	if(resolvers.contains(fullName)) {
-		resolvers[fullName]->deleteLater();
-		resolvers.remove(fullName);
-	}
+	// Stop resolving the host of this service
+	resolverPool.release(fullName);
 
 	// Remove the service from the list of services
 	serviceRepository.getServices().remove(fullName);
@@ -89,4 +277,33 @@ void ServiceDiscovery::onServiceRemoved(const QMdnsEngine::Service &service)
 
 	// Notify clients
 	serviceRepository.notifyRemoveService(fullName);
-}
\ No newline at end of file
+}
+
+void ServiceDiscovery::onAddressResolved(const QByteArray &fullName, const QHostAddress &address)
+{
+	QMDNSENGINE_TRACE_SPAN("addressResolved", "server");
+
+	QMap<QByteArray, QList<QString>> &addresses = serviceRepository.getAddresses();
+
+	// Prevent duplicate address entries for a service, if for some reason that address is resolved more than once
+	if(!addresses[fullName].contains(address.toString())) {
+		// Add the address to the list of addresses of this service
+		addresses[fullName].append(address.toString());
+
+		// Notify clients
+		serviceRepository.notifyAddOrUpdateService(serviceRepository.getServices()[fullName]);
+	}
+}
+
+void ServiceDiscovery::onAddressExpired(const QByteArray &fullName, const QHostAddress &address)
+{
+	QMDNSENGINE_TRACE_SPAN("addressExpired", "server");
+
+	QMap<QByteArray, QList<QString>> &addresses = serviceRepository.getAddresses();
+
+	// Remove the address from the list of addresses of this service
+	if(addresses[fullName].removeOne(address.toString())) {
+		// Notify clients
+		serviceRepository.notifyAddOrUpdateService(serviceRepository.getServices()[fullName]);
+	}
+}
@@ -4,8 +4,11 @@
 #include <qmdnsengine/server.h>
 #include <qmdnsengine/cache.h>
 #include <qmdnsengine/browser.h>
-#include <qmdnsengine/resolver.h>
+#include <qmdnsengine/message.h>
+#include <QTimer>
 #include "../common/servicerepository.h"
+#include "resolverpool.h"
+#include "metrics.h"
 
 class ServiceDiscovery : public QObject
 {
@@ -14,20 +17,36 @@ class ServiceDiscovery : public QObject
 	private:
 		ServiceRepository &serviceRepository;
 		bool noCache;
+		QString cacheFile;
 		
 		QMdnsEngine::Server server;
 		QMdnsEngine::Cache cache;
 		QMdnsEngine::Browser browser;
-		QMap<QByteArray, QMdnsEngine::Resolver *> resolvers;
+		ResolverPool resolverPool;
+		QTimer cacheTimer;
+		QTimer verifyTimer;
+		QList<QMdnsEngine::Message> verifyMessages;
+		QMdnsEngine::Server::Stats scrapedServerStats;
+		QMdnsEngine::Cache::Stats scrapedCacheStats;
+
+		void setAddresses(const QByteArray &fullName, const QList<QHostAddress> &addresses);
+		void loadCache();
+		void verifyCache();
+		void registerMetrics(Metrics &metrics);
 
 	public:
-		ServiceDiscovery(ServiceRepository &serviceRepository, const QString &type, bool noCache);
+		ServiceDiscovery(ServiceRepository &serviceRepository, Metrics &metrics, const QList<QString> &types, bool noCache, const QString &cacheFile, int cacheMaxEntries, qint64 cacheMaxSize, int cacheMaxSourceEntries, int cacheStatsInterval);
 		~ServiceDiscovery();
 
 	private slots:
+		void saveCache();
+		void onVerifyTimeout();
+		void onCacheStatsUpdated(const QMdnsEngine::Cache::Stats &stats);
 		void onServiceAdded(const QMdnsEngine::Service &service);
 		void onServiceUpdated(const QMdnsEngine::Service &service);
 		void onServiceRemoved(const QMdnsEngine::Service &service);
+		void onAddressResolved(const QByteArray &fullName, const QHostAddress &address);
+		void onAddressExpired(const QByteArray &fullName, const QHostAddress &address);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,135 @@
+#include "servicequery.h"
+#include <QUrlQuery>
+#include <algorithm>
+
+ServiceQuery::ServiceQuery(ServiceRepository &serviceRepository) :
+	serviceRepository(serviceRepository)
+{
+	// Index the services that are already known, for example received from a leading process
+	const QMap<QByteArray, QMdnsEngine::Service> &services = serviceRepository.getServices();
+	for(auto it = services.constBegin(); it != services.constEnd(); it++) {
+		addToIndex(it.key(), *it);
+	}
+
+	// Observe the repository
+	serviceRepository.addObserver(this);
+}
+
+void ServiceQuery::addToIndex(const QByteArray &fullName, const QMdnsEngine::Service &service)
+{
+	types[service.type()].insert(fullName);
+	serviceTypes[fullName] = service.type();
+
+	QList<QByteArray> &keys = attributeKeys[fullName];
+	const QMap<QByteArray, QByteArray> serviceAttributes = service.attributes();
+	for(auto it = serviceAttributes.constBegin(); it != serviceAttributes.constEnd(); it++) {
+		keys.append(it.key());
+		keys.append(it.key() + "=" + it.value());
+	}
+	for(const auto &key : keys) {
+		attributes[key].insert(fullName);
+	}
+}
+
+void ServiceQuery::removeFromIndex(const QByteArray &fullName)
+{
+	for(const auto &key : attributeKeys.take(fullName)) {
+		auto it = attributes.find(key);
+		if(it != attributes.end()) {
+			it->remove(fullName);
+			if(it->isEmpty()) {
+				attributes.erase(it);
+			}
+		}
+	}
+
+	auto it = types.find(serviceTypes.take(fullName));
+	if(it != types.end()) {
+		it->remove(fullName);
+		if(it->isEmpty()) {
+			types.erase(it);
+		}
+	}
+}
+
+void ServiceQuery::onAddOrUpdateService(const QMdnsEngine::Service &service)
+{
+	QByteArray fullName = serviceRepository.getServiceFullName(service);
+	removeFromIndex(fullName);
+	addToIndex(fullName, service);
+}
+
+void ServiceQuery::onRemoveService(const QString &fullName)
+{
+	removeFromIndex(fullName.toUtf8());
+}
+
+QByteArray ServiceQuery::getETag() const
+{
+	return "\"" + serviceRepository.getEpoch() + "-" + QByteArray::number(serviceRepository.getRevision()) + "\"";
+}
+
+HttpResponse ServiceQuery::handleRequest(const HttpRequest &request)
+{
+	HttpResponse response;
+	response.contentType = "application/json";
+
+	// Every change increases the revision, so an unchanged revision means an unchanged answer
+	QByteArray eTag = getETag();
+	response.headers["ETag"] = eTag;
+	response.headers["Cache-Control"] = "no-cache";
+	for(const auto &match : request.headers.value("if-none-match").split(',')) {
+		if(match.trimmed() == eTag || match.trimmed() == "*") {
+			response.status = 304;
+			return response;
+		}
+	}
+
+	// Narrow the candidates down using the indexes, starting with the most selective condition
+	QUrlQuery query(request.url);
+	const QMap<QByteArray, QMdnsEngine::Service> &services = serviceRepository.getServices();
+	QList<QSet<QByteArray>> conditions;
+	if(query.hasQueryItem("fullname")) {
+		QByteArray fullName = query.queryItemValue("fullname", QUrl::FullyDecoded).toUtf8();
+		conditions.append(services.contains(fullName) ? QSet<QByteArray>({fullName}) : QSet<QByteArray>());
+	}
+	if(query.hasQueryItem("type")) {
+		conditions.append(types.value(query.queryItemValue("type", QUrl::FullyDecoded).toUtf8()));
+	}
+	for(const auto &attribute : query.allQueryItemValues("attribute", QUrl::FullyDecoded)) {
+		conditions.append(attributes.value(attribute.toUtf8()));
+	}
+
+	QList<QByteArray> fullNames;
+	if(conditions.isEmpty()) {
+		fullNames = services.keys();
+	}
+	else {
+		std::sort(conditions.begin(), conditions.end(), [](const QSet<QByteArray> &a, const QSet<QByteArray> &b) {
+			return a.size() < b.size();
+		});
+		QSet<QByteArray> matches = conditions.takeFirst();
+		for(const auto &condition : conditions) {
+			matches.intersect(condition);
+		}
+		fullNames = matches.values();
+		std::sort(fullNames.begin(), fullNames.end());
+	}
+
+	// A lookup by full name of a service that doesn't exist is not found, other queries just have no results
+	if(query.hasQueryItem("fullname") && fullNames.isEmpty()) {
+		response.status = 404;
+	}
+
+	// Reuse the encoded services shared with the websocket clients
+	response.body = "{\"revision\":" + QByteArray::number(serviceRepository.getRevision()) + ",\"epoch\":\"" + serviceRepository.getEpoch() + "\",\"services\":[";
+	for(int i = 0; i < fullNames.size(); i++) {
+		if(i > 0) {
+			response.body += ',';
+		}
+		response.body += serviceRepository.getJsonService(services[fullNames[i]]);
+	}
+	response.body += "]}";
+
+	return response;
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef SERVICEQUERY_H
+#define SERVICEQUERY_H
+
+#include <QHash>
+#include <QSet>
+#include "../common/servicerepository.h"
+#include "httpserver.h"
+
+// Answers HTTP lookups of services by full name, type or attribute, for consumers that don't need a websocket.
+// Responses are tagged with the revision of the repository, so polling without any changes costs no more than a
+// comparison.
+class ServiceQuery : public Observer
+{
+	private:
+		ServiceRepository &serviceRepository;
+
+		// Full names of the services by type and by attribute, attributes are indexed both as 'key' and 'key=value'
+		QHash<QByteArray, QSet<QByteArray>> types;
+		QHash<QByteArray, QSet<QByteArray>> attributes;
+		QHash<QByteArray, QByteArray> serviceTypes;
+		QHash<QByteArray, QList<QByteArray>> attributeKeys;
+
+		void addToIndex(const QByteArray &fullName, const QMdnsEngine::Service &service);
+		void removeFromIndex(const QByteArray &fullName);
+		QByteArray getETag() const;
+
+	public:
+		ServiceQuery(ServiceRepository &serviceRepository);
+
+		// GET /services[?fullname=...][&type=...][&attribute=key[=value]]...
+		HttpResponse handleRequest(const HttpRequest &request);
+
+		void onAddOrUpdateService(const QMdnsEngine::Service &service) override;
+		void onRemoveService(const QString &fullName) override;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include <QTest>
+#include "testservices.h"
+#include "../src/server/federation.h"
+#include "../src/server/serversocket.h"
+
+static const quint16 BasePort = 47730;
+
+class TestFederation : public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void testMerge();
+		void testLoop();
+};
+
+void TestFederation::testMerge()
+{
+	ServiceRepository federatedRepository;
+	Metrics metrics;
+	ServerSocket serverSocket(federatedRepository, metrics, "test", "127.0.0.1", BasePort, -1, -1, -1, false, false, false);
+	federatedRepository.addOrUpdateIfChanged(makeJsonService("remote", 1));
+	federatedRepository.addOrUpdateIfChanged(makeJsonService("shared", 2));
+
+	// Services discovered locally take precedence over the ones of federated servers
+	ServiceRepository serviceRepository;
+	serviceRepository.addOrUpdateIfChanged(makeJsonService("shared", 1));
+	Federation federation(serviceRepository, {"ws://127.0.0.1:" + QString::number(BasePort)}, "b", -1, false);
+
+	QTRY_VERIFY(serviceRepository.getServices().contains("remote._http._tcp.local."));
+	QCOMPARE(serviceRepository.getServices().value("shared._http._tcp.local.").port(), quint16(1));
+
+	// Merged services are sent on with this server added to their path
+	const QMdnsEngine::Service remote = serviceRepository.getServices().value("remote._http._tcp.local.");
+	QVERIFY(serviceRepository.getJsonService(remote).contains("\"path\":[\"b\"]"));
+
+	// The federated service takes over once the local one disappears
+	serviceRepository.removeIfExists("shared._http._tcp.local.");
+	QTRY_COMPARE(serviceRepository.getServices().value("shared._http._tcp.local.").port(), quint16(2));
+}
+
+void TestFederation::testLoop()
+{
+	ServiceRepository federatedRepository;
+	Metrics metrics;
+	ServerSocket serverSocket(federatedRepository, metrics, "test", "127.0.0.1", BasePort + 1, -1, -1, -1, false, false, false);
+	federatedRepository.addOrUpdateIfChanged(makeJsonService("remote", 1));
+	federatedRepository.addOrUpdateIfChanged(makeJsonService("looped", 2, QJsonObject(), {"a", "b"}));
+
+	// Services that already passed through this server are not merged back
+	ServiceRepository serviceRepository;
+	Federation federation(serviceRepository, {"ws://127.0.0.1:" + QString::number(BasePort + 1)}, "b", -1, false);
+	QTRY_VERIFY(serviceRepository.getServices().contains("remote._http._tcp.local."));
+	QVERIFY(!serviceRepository.getServices().contains("looped._http._tcp.local."));
+
+	// A merged service coming back through another server is removed, it disappeared where it was discovered
+	federatedRepository.addOrUpdateIfChanged(makeJsonService("remote", 1, QJsonObject(), {"b", "c"}));
+	QTRY_VERIFY(!serviceRepository.getServices().contains("remote._http._tcp.local."));
+}
+
+QTEST_GUILESS_MAIN(TestFederation)
+#include "testfederation.moc"
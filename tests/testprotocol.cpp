@@ -0,0 +1,188 @@
+#include <QTest>
+#include "testservices.h"
+#include "../src/common/clientsocket.h"
+#include "../src/server/serversocket.h"
+
+// Every test listens on its own port, so a socket of a previous test lingering in TIME_WAIT doesn't interfere
+static const quint16 BasePort = 47710;
+
+static QString getUrl(quint16 port)
+{
+	return "ws://127.0.0.1:" + QString::number(port);
+}
+
+// Reads a sample from the metrics, which tell which messages the server sent
+static double getSample(const Metrics &metrics, const QByteArray &sample)
+{
+	for(const auto &line : metrics.toPrometheus().split('\n')) {
+		if(line.startsWith(sample + " ")) {
+			return line.mid(sample.size() + 1).toDouble();
+		}
+	}
+	return -1;
+}
+
+static double getMessagesSent(const Metrics &metrics, const QByteArray &type)
+{
+	return getSample(metrics, "websocket_messages_sent_total{type=\"" + type + "\"}");
+}
+
+class TestProtocol : public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void testSnapshot();
+		void testChanges();
+		void testDelta();
+		void testUnknownEpoch();
+		void testStreamedSnapshot();
+		void testHeartbeat();
+		void testCompression();
+};
+
+void TestProtocol::testSnapshot()
+{
+	ServiceRepository serverRepository;
+	serverRepository.addOrUpdateIfChanged(makeJsonService("a", 1));
+	Metrics metrics;
+	ServerSocket serverSocket(serverRepository, metrics, "test", "127.0.0.1", BasePort, -1, -1, -1, false, false, false);
+
+	ServiceRepository clientRepository;
+	ClientSocket clientSocket(clientRepository, nullptr, getUrl(BasePort), -1, 100, 1000, -1, -1, false, false, false);
+
+	// A new client receives all services together with the revision they belong to
+	QTRY_COMPARE(clientRepository.getServices().keys(), serverRepository.getServices().keys());
+	QCOMPARE(clientRepository.getEpoch(), serverRepository.getEpoch());
+	QCOMPARE(clientRepository.getRevision(), serverRepository.getRevision());
+	QCOMPARE(getMessagesSent(metrics, "all"), 1.0);
+}
+
+void TestProtocol::testChanges()
+{
+	ServiceRepository serverRepository;
+	serverRepository.addOrUpdateIfChanged(makeJsonService("a", 1));
+	Metrics metrics;
+	ServerSocket serverSocket(serverRepository, metrics, "test", "127.0.0.1", BasePort + 1, -1, -1, -1, false, false, false);
+
+	ServiceRepository clientRepository;
+	ClientSocket clientSocket(clientRepository, nullptr, getUrl(BasePort + 1), -1, 100, 1000, -1, -1, false, false, false);
+	QTRY_COMPARE(clientRepository.getServices().size(), 1);
+
+	// Connected clients receive every change as it happens
+	serverRepository.addOrUpdateIfChanged(makeJsonService("b", 2));
+	serverRepository.removeIfExists("a._http._tcp.local.");
+
+	QTRY_COMPARE(clientRepository.getRevision(), serverRepository.getRevision());
+	QCOMPARE(clientRepository.getServices().keys(), QList<QByteArray>({"b._http._tcp.local."}));
+	QCOMPARE(getMessagesSent(metrics, "add_or_update"), 1.0);
+	QCOMPARE(getMessagesSent(metrics, "remove"), 1.0);
+}
+
+void TestProtocol::testDelta()
+{
+	ServiceRepository serverRepository;
+	serverRepository.addOrUpdateIfChanged(makeJsonService("a", 1));
+	serverRepository.addOrUpdateIfChanged(makeJsonService("b", 2));
+	Metrics metrics;
+	ServerSocket serverSocket(serverRepository, metrics, "test", "127.0.0.1", BasePort + 2, -1, -1, -1, false, false, false);
+
+	// Restore the services of the current revision, like a client restarting with its cache
+	ServiceRepository clientRepository;
+	clientRepository.applySnapshot({makeJsonService("a", 1), makeJsonService("b", 2)});
+	clientRepository.setEpoch(serverRepository.getEpoch());
+	clientRepository.setRevision(serverRepository.getRevision());
+
+	serverRepository.addOrUpdateIfChanged(makeJsonService("c", 3));
+	serverRepository.removeIfExists("a._http._tcp.local.");
+
+	// Only the changes since the cached revision are sent
+	ClientSocket clientSocket(clientRepository, nullptr, getUrl(BasePort + 2), -1, 100, 1000, -1, -1, false, false, false);
+	QTRY_COMPARE(clientRepository.getRevision(), serverRepository.getRevision());
+	QCOMPARE(clientRepository.getServices().keys(), QList<QByteArray>({"b._http._tcp.local.", "c._http._tcp.local."}));
+	QCOMPARE(getMessagesSent(metrics, "delta"), 1.0);
+	QCOMPARE(getMessagesSent(metrics, "all"), 0.0);
+}
+
+void TestProtocol::testUnknownEpoch()
+{
+	ServiceRepository serverRepository;
+	serverRepository.addOrUpdateIfChanged(makeJsonService("a", 1));
+	Metrics metrics;
+	ServerSocket serverSocket(serverRepository, metrics, "test", "127.0.0.1", BasePort + 3, -1, -1, -1, false, false, false);
+
+	// The revision of a restarted server can't be compared, so all services are sent instead
+	ServiceRepository clientRepository;
+	clientRepository.applySnapshot({makeJsonService("b", 2)});
+	clientRepository.setEpoch("previous");
+	clientRepository.setRevision(serverRepository.getRevision());
+
+	ClientSocket clientSocket(clientRepository, nullptr, getUrl(BasePort + 3), -1, 100, 1000, -1, -1, false, false, false);
+	QTRY_COMPARE(clientRepository.getEpoch(), serverRepository.getEpoch());
+	QCOMPARE(clientRepository.getServices().keys(), QList<QByteArray>({"a._http._tcp.local."}));
+	QCOMPARE(getMessagesSent(metrics, "all"), 1.0);
+	QCOMPARE(getMessagesSent(metrics, "delta"), 0.0);
+}
+
+void TestProtocol::testStreamedSnapshot()
+{
+	ServiceRepository serverRepository;
+	for(int i = 0; i < 1000; i++) {
+		serverRepository.addOrUpdateIfChanged(makeJsonService("service " + QString::number(i), i, {{"description", QString(100, 'x')}}));
+	}
+	Metrics metrics;
+	ServerSocket serverSocket(serverRepository, metrics, "test", "127.0.0.1", BasePort + 4, -1, -1, -1, false, false, false);
+
+	ServiceRepository clientRepository;
+	ClientSocket clientSocket(clientRepository, nullptr, getUrl(BasePort + 4), -1, 100, 1000, -1, -1, false, true, false);
+	QSignalSpy snapshotStartedSpy(&clientSocket, &ClientSocket::snapshotStarted);
+
+	// The snapshot is split into several chunks, the revision is only taken over at its end
+	QTRY_COMPARE(clientRepository.getRevision(), serverRepository.getRevision());
+	QCOMPARE(clientRepository.getServices().size(), 1000);
+	QCOMPARE(snapshotStartedSpy.count(), 1);
+	QCOMPARE(getMessagesSent(metrics, "all_begin"), 1.0);
+	QVERIFY(getMessagesSent(metrics, "all_chunk") > 1);
+	QCOMPARE(getMessagesSent(metrics, "all_end"), 1.0);
+}
+
+void TestProtocol::testHeartbeat()
+{
+	// The server only remembers the changes it observed
+	ServiceRepository serverRepository;
+	Metrics metrics;
+	ServerSocket serverSocket(serverRepository, metrics, "test", "127.0.0.1", BasePort + 5, -1, -1, 50, false, false, false);
+	serverRepository.addOrUpdateIfChanged(makeJsonService("a", 1));
+
+	ServiceRepository clientRepository;
+	ClientSocket clientSocket(clientRepository, nullptr, getUrl(BasePort + 5), -1, 100, 1000, -1, -1, false, false, false);
+	QTRY_COMPARE(clientRepository.getServices().size(), 1);
+
+	// Pretend the client missed a change, the next heartbeat makes it ask for the changes since its revision
+	clientRepository.removeIfExists("a._http._tcp.local.");
+	clientRepository.setRevision(serverRepository.getRevision() - 1);
+
+	QTRY_COMPARE(clientRepository.getRevision(), serverRepository.getRevision());
+	QCOMPARE(clientRepository.getServices().size(), 1);
+	QVERIFY(getMessagesSent(metrics, "heartbeat") >= 1);
+	QCOMPARE(getMessagesSent(metrics, "delta"), 1.0);
+}
+
+void TestProtocol::testCompression()
+{
+	ServiceRepository serverRepository;
+	QString description(4096, 'x');
+	serverRepository.addOrUpdateIfChanged(makeJsonService("a", 1, {{"description", description}}));
+	Metrics metrics;
+	ServerSocket serverSocket(serverRepository, metrics, "test", "127.0.0.1", BasePort + 6, -1, -1, -1, false, false, false);
+
+	// Large messages are compressed for clients asking for it
+	ServiceRepository clientRepository;
+	ClientSocket clientSocket(clientRepository, nullptr, getUrl(BasePort + 6), -1, 100, 1000, -1, -1, true, false, false);
+	QTRY_COMPARE(clientRepository.getServices().size(), 1);
+	QCOMPARE(clientRepository.getServices().first().attributes().value("description"), description.toUtf8());
+	QCOMPARE(getSample(metrics, "websocket_compressions_total"), 1.0);
+}
+
+QTEST_GUILESS_MAIN(TestProtocol)
+#include "testprotocol.moc"
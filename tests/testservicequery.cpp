@@ -0,0 +1,83 @@
+#include <QTest>
+#include "testservices.h"
+#include "../src/server/servicequery.h"
+
+static HttpRequest makeRequest(const QString &url, const QByteArray &eTag = QByteArray())
+{
+	HttpRequest request;
+	request.method = "GET";
+	request.url = QUrl(url);
+	if(!eTag.isEmpty()) {
+		request.headers["if-none-match"] = eTag;
+	}
+	return request;
+}
+
+class TestServiceQuery : public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void testLookups();
+		void testNotModified();
+		void testModified();
+};
+
+void TestServiceQuery::testLookups()
+{
+	ServiceRepository serviceRepository;
+	serviceRepository.addOrUpdateIfChanged(makeJsonService("a", 1, {{"path", "/a"}}));
+	serviceRepository.addOrUpdateIfChanged(makeJsonService("b", 2, {{"path", "/b"}}));
+	ServiceQuery serviceQuery(serviceRepository);
+
+	HttpResponse response = serviceQuery.handleRequest(makeRequest("/services?attribute=path%3D/b"));
+	QCOMPARE(response.status, 200);
+	QVERIFY(response.body.contains("\"fullname\":\"b._http._tcp.local.\""));
+	QVERIFY(!response.body.contains("\"fullname\":\"a._http._tcp.local.\""));
+
+	// Looking up a service by a full name that doesn't exist is not found
+	QCOMPARE(serviceQuery.handleRequest(makeRequest("/services?fullname=c._http._tcp.local.")).status, 404);
+}
+
+void TestServiceQuery::testNotModified()
+{
+	ServiceRepository serviceRepository;
+	serviceRepository.setEpoch("epoch");
+	serviceRepository.addOrUpdateIfChanged(makeJsonService("a", 1));
+	ServiceQuery serviceQuery(serviceRepository);
+
+	HttpResponse response = serviceQuery.handleRequest(makeRequest("/services"));
+	QByteArray eTag = response.headers.value("ETag");
+	QCOMPARE(eTag, QByteArray("\"epoch-1\""));
+
+	// Polling with the received tag answers without a body, whichever lookup it was for
+	response = serviceQuery.handleRequest(makeRequest("/services?type=_http._tcp.local.", "\"other\", " + eTag));
+	QCOMPARE(response.status, 304);
+	QVERIFY(response.body.isEmpty());
+	QCOMPARE(response.headers.value("ETag"), eTag);
+}
+
+void TestServiceQuery::testModified()
+{
+	ServiceRepository serviceRepository;
+	serviceRepository.setEpoch("epoch");
+	serviceRepository.addOrUpdateIfChanged(makeJsonService("a", 1));
+	ServiceQuery serviceQuery(serviceRepository);
+
+	QByteArray eTag = serviceQuery.handleRequest(makeRequest("/services")).headers.value("ETag");
+	serviceRepository.removeIfExists("a._http._tcp.local.");
+
+	// Any change invalidates the tag, and removed services are no longer indexed
+	HttpResponse response = serviceQuery.handleRequest(makeRequest("/services?type=_http._tcp.local.", eTag));
+	QCOMPARE(response.status, 200);
+	QVERIFY(response.headers.value("ETag") != eTag);
+	QVERIFY(response.body.contains("\"services\":[]"));
+
+	// A new server process starts a new epoch, so tags of the previous one never match
+	serviceRepository.setEpoch("restarted");
+	serviceRepository.setRevision(1);
+	QCOMPARE(serviceQuery.handleRequest(makeRequest("/services", eTag)).status, 200);
+}
+
+QTEST_GUILESS_MAIN(TestServiceQuery)
+#include "testservicequery.moc"
@@ -0,0 +1,91 @@
+#include <QTest>
+#include "testservices.h"
+
+class TestServiceRepository : public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void testApplySnapshot();
+		void testUnchangedSnapshot();
+		void testRemoveUnknownService();
+		void testRevisions();
+		void testPath();
+};
+
+void TestServiceRepository::testApplySnapshot()
+{
+	ServiceRepository serviceRepository;
+	CountingObserver observer;
+	serviceRepository.addObserver(&observer);
+
+	serviceRepository.applySnapshot({makeJsonService("a", 1), makeJsonService("b", 2)});
+	serviceRepository.applySnapshot({makeJsonService("b", 3), makeJsonService("c", 4)});
+
+	// The second snapshot updates b, adds c and removes a
+	QCOMPARE(serviceRepository.getServices().keys(), QList<QByteArray>({"b._http._tcp.local.", "c._http._tcp.local."}));
+	QCOMPARE(serviceRepository.getServices().value("b._http._tcp.local.").port(), quint16(3));
+	QCOMPARE(observer.addedOrUpdated, 4);
+	QCOMPARE(observer.removed, 1);
+}
+
+void TestServiceRepository::testUnchangedSnapshot()
+{
+	ServiceRepository serviceRepository;
+	serviceRepository.applySnapshot({makeJsonService("a", 1), makeJsonService("b", 2)});
+
+	// Refreshing with the same services notifies nothing
+	CountingObserver observer;
+	serviceRepository.addObserver(&observer);
+	serviceRepository.applySnapshot({makeJsonService("b", 2), makeJsonService("a", 1)});
+
+	QCOMPARE(observer.addedOrUpdated, 0);
+	QCOMPARE(observer.removed, 0);
+}
+
+void TestServiceRepository::testRemoveUnknownService()
+{
+	ServiceRepository serviceRepository;
+	CountingObserver observer;
+	serviceRepository.addObserver(&observer);
+
+	// Changes since a revision can name services that were never received
+	serviceRepository.removeIfExists("a._http._tcp.local.");
+
+	QCOMPARE(observer.removed, 0);
+	QCOMPARE(serviceRepository.getRevision(), quint64(0));
+}
+
+void TestServiceRepository::testRevisions()
+{
+	ServiceRepository serviceRepository;
+	serviceRepository.addOrUpdateIfChanged(makeJsonService("a", 1));
+	serviceRepository.addOrUpdateIfChanged(makeJsonService("a", 1));
+	serviceRepository.removeIfExists("a._http._tcp.local.");
+	QCOMPARE(serviceRepository.getRevision(), quint64(2));
+
+	// Mirrors only store the revisions of the server
+	ServiceRepository mirror;
+	mirror.setCountRevisions(false);
+	mirror.addOrUpdateIfChanged(makeJsonService("a", 1));
+	QCOMPARE(mirror.getRevision(), quint64(0));
+}
+
+void TestServiceRepository::testPath()
+{
+	ServiceRepository serviceRepository;
+	serviceRepository.setOrigin("b");
+	serviceRepository.addOrUpdateIfChanged(makeJsonService("a", 1, QJsonObject(), {"a"}));
+
+	// A service only differing in its path is updated, and the path is sent on extended with this server
+	CountingObserver observer;
+	serviceRepository.addObserver(&observer);
+	serviceRepository.addOrUpdateIfChanged(makeJsonService("a", 1, QJsonObject(), {"c"}));
+
+	QCOMPARE(observer.addedOrUpdated, 1);
+	QCOMPARE(serviceRepository.getPaths().value("a._http._tcp.local."), QList<QString>({"c"}));
+	QVERIFY(serviceRepository.getJsonService(serviceRepository.getServices().first()).contains("\"path\":[\"c\",\"b\"]"));
+}
+
+QTEST_GUILESS_MAIN(TestServiceRepository)
+#include "testservicerepository.moc"
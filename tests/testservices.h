@@ -0,0 +1,37 @@
+#ifndef TESTSERVICES_H
+#define TESTSERVICES_H
+
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QSignalSpy>
+#include "../src/common/servicerepository.h"
+
+// Encodes a service the way servers send it, all test services share the type, hostname and address
+inline QJsonObject makeJsonService(const QString &name, int port, const QJsonObject &attributes = QJsonObject(), const QJsonArray &path = QJsonArray())
+{
+	QJsonObject jsonService;
+	jsonService["name"] = name;
+	jsonService["hostname"] = "host.local.";
+	jsonService["port"] = port;
+	jsonService["type"] = "_http._tcp.local.";
+	jsonService["fullname"] = name + "._http._tcp.local.";
+	jsonService["attributes"] = attributes;
+	jsonService["addresses"] = QJsonArray({"192.168.1.1"});
+	if(!path.isEmpty()) {
+		jsonService["path"] = path;
+	}
+	return jsonService;
+}
+
+// Counts the notifications of a repository
+class CountingObserver : public Observer
+{
+	public:
+		int addedOrUpdated = 0;
+		int removed = 0;
+
+		void onAddOrUpdateService(const QMdnsEngine::Service &) override { addedOrUpdated++; }
+		void onRemoveService(const QString &) override { removed++; }
+};
+
+#endif